@@ -0,0 +1,104 @@
+#include "spaceinvaders.h"
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+
+constexpr uint32_t WAVE_SCALES[] { 1, 4, 16, 64 };
+
+constexpr size_t SAMPLES = 1000;
+constexpr size_t CALLS_PER_SAMPLE = 16;
+
+// loadModel reads models.txt from disk, so it gets fewer and unbatched samples
+constexpr size_t LOAD_SAMPLES = 100;
+
+// drives the simulation headlessly and times its steps in isolation
+class Bench : public SpaceInvaders {
+public:
+	explicit Bench(uint32_t scale) {
+		waveScale = scale;
+		rng.seed(1);
+
+		initHeadless();
+		setup();
+	}
+
+	size_t entityCount() const {
+		return entities.size();
+	}
+
+	// keeps the player shooting between samples so there is always something to collide
+	void advance() {
+		shoot(playerIndex, playerBulletIndex, playerBulletCount, playerCurrentBullet);
+		doPlayerAnimation();
+		doBulletAnimation();
+	}
+
+	void measure(const std::string& name, size_t sampleCount, size_t callsPerSample, const std::function<void()>& step) {
+		std::vector<double> samples(sampleCount);
+
+		for (double& sample : samples) {
+			advance();
+
+			const auto start = std::chrono::high_resolution_clock::now();
+
+			for (size_t i=0; i<callsPerSample; ++i) {
+				step();
+			}
+
+			const auto end = std::chrono::high_resolution_clock::now();
+			sample = std::chrono::duration<double, std::nano>(end - start).count() / callsPerSample;
+		}
+
+		report(name, samples);
+	}
+
+	void report(const std::string& name, std::vector<double>& samples) {
+		double total = 0;
+
+		for (double sample : samples) {
+			total += sample;
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		auto percentile = [&](double p) {
+			return samples[std::min(samples.size() - 1, (size_t) (p * samples.size()))];
+		};
+
+		std::cout << std::left << std::setw(20) << name << std::right
+			<< std::setw(10) << entityCount()
+			<< std::fixed << std::setprecision(1)
+			<< std::setw(14) << total / samples.size()
+			<< std::setw(14) << percentile(0.5)
+			<< std::setw(14) << percentile(0.9)
+			<< std::setw(14) << percentile(0.99) << std::endl;
+	}
+
+	void runAll() {
+		measure("detectCollisions", SAMPLES, CALLS_PER_SAMPLE, [&] { detectCollisions(); });
+		measure("doMobAnimation", SAMPLES, CALLS_PER_SAMPLE, [&] { doMobAnimation(); });
+		measure("doRandomShooting", SAMPLES, CALLS_PER_SAMPLE, [&] { doRandomShooting(); });
+		measure("loadModel", LOAD_SAMPLES, 1, [&] { loadModel(); });
+	}
+};
+
+int main() {
+	std::cout << std::left << std::setw(20) << "benchmark" << std::right
+		<< std::setw(10) << "entities"
+		<< std::setw(14) << "ns/op"
+		<< std::setw(14) << "p50"
+		<< std::setw(14) << "p90"
+		<< std::setw(14) << "p99" << std::endl;
+
+	try {
+		for (uint32_t scale : WAVE_SCALES) {
+			Bench(scale).runAll();
+		}
+	} catch (const std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
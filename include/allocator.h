@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <ostream>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// A range of a device memory block handed out by DeviceAllocator, mapped points at offset if the block is host visible
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	char* mapped = nullptr;
+
+	uint32_t pool = 0;
+	uint32_t block = 0;
+};
+
+// Sub-allocates buffers and images out of large vkAllocateMemory blocks, with one list of blocks per memory type
+// and resource kind. Linear and optimally tiled resources never share a block, so bufferImageGranularity can't be
+// violated. Requests larger than BLOCK_SIZE get a dedicated block that is released as soon as it is freed. Host
+// visible blocks stay mapped for their whole lifetime, so callers must not map the memory themselves.
+class DeviceAllocator {
+public:
+	static constexpr VkDeviceSize BLOCK_SIZE = 16 * 1024 * 1024;
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device);
+	void destroy();
+
+	Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+	void free(Allocation& allocation);
+
+	void printStatistics(std::ostream& out) const;
+
+private:
+	struct Range {
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		VkDeviceSize used = 0;
+		char* mapped = nullptr;
+		uint32_t allocations = 0;
+
+		// sorted by offset and never adjacent, neighbours are merged on free
+		std::vector<Range> freeRanges;
+	};
+
+	struct Pool {
+		std::vector<Block> blocks;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+
+	// indexed by memory type * 2 + linear
+	std::vector<Pool> pools;
+	uint32_t deviceAllocations = 0;
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	bool allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, Allocation& allocation);
+	uint32_t createBlock(uint32_t poolIndex, VkDeviceSize size);
+	void releaseBlock(Block& block);
+};
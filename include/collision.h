@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Number of targets tested per call to sphereHitMask. Target arrays passed to it must have this many readable
+// entries from the given pointer, so callers pad their SoA arrays up to a multiple of it.
+constexpr uint32_t COLLISION_LANES = 8;
+
+// Tests the point (px, py, pz) against COLLISION_LANES spheres given as SoA arrays and returns a bitmask with bit i
+// set when the point lies strictly inside sphere i. Padding lanes with a radius of 0 never hit.
+inline uint32_t sphereHitMask(float px, float py, float pz, const float* x, const float* y, const float* z, const float* radius) {
+#if defined(__AVX2__)
+	const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x), _mm256_set1_ps(px));
+	const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y), _mm256_set1_ps(py));
+	const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z), _mm256_set1_ps(pz));
+	const __m256 r = _mm256_loadu_ps(radius);
+
+	const __m256 distance2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+	return (uint32_t) _mm256_movemask_ps(_mm256_cmp_ps(distance2, _mm256_mul_ps(r, r), _CMP_LT_OQ));
+#elif defined(__SSE2__)
+	const __m128 qx = _mm_set1_ps(px);
+	const __m128 qy = _mm_set1_ps(py);
+	const __m128 qz = _mm_set1_ps(pz);
+
+	uint32_t mask = 0;
+
+	for (uint32_t i = 0; i < COLLISION_LANES; i += 4) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), qx);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), qy);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), qz);
+		const __m128 r = _mm_loadu_ps(radius + i);
+
+		const __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		mask |= (uint32_t) _mm_movemask_ps(_mm_cmplt_ps(distance2, _mm_mul_ps(r, r))) << i;
+	}
+
+	return mask;
+#else
+	uint32_t mask = 0;
+
+	for (uint32_t i = 0; i < COLLISION_LANES; i++) {
+		const float dx = x[i] - px;
+		const float dy = y[i] - py;
+		const float dz = z[i] - pz;
+
+		mask |= (uint32_t) (dx * dx + dy * dy + dz * dz < radius[i] * radius[i]) << i;
+	}
+
+	return mask;
+#endif
+}
@@ -2,8 +2,10 @@
 
 #include <set>
 #include <array>
+#include <cmath>
 #include <vector>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <unordered_map>
@@ -18,17 +20,27 @@
 
 #include "vertex.h"
 #include "model.h"
+#include "entities.h"
 #include "ubo.h"
+#include "profiler.h"
+#include "allocator.h"
+#include "uploader.h"
 
 struct QueueFamilyIndices {
 	int graphicsFamily = -1;
 	int presentFamily = -1;
+	// a family without graphics support if the device has one, otherwise the graphics family
+	int transferFamily = -1;
 
 	bool isComplete() {
 		return graphicsFamily >= 0 && presentFamily >= 0;
 	}
 };
 
+enum class RenderMode {
+	PerModel, Instanced, PushConstants
+};
+
 struct SwapChainSupportDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
 	std::vector<VkSurfaceFormatKHR> formats;
@@ -37,12 +49,39 @@ struct SwapChainSupportDetails {
 
 class Engine {
 public:
+	void parseArguments(int argc, char* argv[]);
 	void run();
 
 protected:
+	RenderMode renderMode = RenderMode::Instanced;
+	// --record-every-frame re-records command buffers each frame and leaves out dead entities
+	bool recordEveryFrame = false;
+
 	bool needsResize = false;
 	bool running;
 
+	// the simulation advances in fixed steps of tickDuration, at most maxTicksPerFrame per rendered frame
+	float tickDuration = 1.0f / 60;
+	uint32_t maxTicksPerFrame = 5;
+
+	// headless runs simulate without a window or Vulkan device, as fast as possible
+	bool headless = false;
+	uint64_t headlessTicks = 60 * 60 * 10;
+	std::vector<char> headlessUniformBuffer;
+
+	// offscreen runs render --ticks frames, one tick each, into images of their own instead of a swap chain, so no
+	// window, surface or present support is needed and CPU implementations such as lavapipe work
+	bool offscreen = false;
+	std::string capturePath;
+	std::vector<Allocation> offscreenImageAllocations;
+
+	// --profile=file records CPU spans and GPU render pass time per frame and writes them as CSV on exit
+	std::string profilePath;
+	FrameProfiler profiler;
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+	float timestampPeriod;
+	std::vector<int64_t> pendingTimestamps;
+
 	GLFWwindow* window;
 
 	VkInstance instance;
@@ -54,8 +93,9 @@ protected:
 
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue transferQueue;
 
-	VkSwapchainKHR swapChain;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
@@ -65,38 +105,72 @@ protected:
 	VkRenderPass renderPass;
 	VkPipelineLayout pipelineLayout;
 	VkPipeline graphicsPipeline;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
 	VkCommandPool commandPool;
 
+	DeviceAllocator allocator;
+	Uploader uploader;
+
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	Allocation textureImageAllocation;
 
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	Allocation vertexBufferAllocation;
 	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
+	Allocation indexBufferAllocation;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
 
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkDescriptorPool descriptorPool;
+	// a single set for every entity, the uniform block is selected with a dynamic offset
+	VkDescriptorSet descriptorSet;
 	std::vector<Model> models;
+	Entities entities;
+	std::vector<DrawBatch> drawBatches;
+
+	// one slice of entities.size() uniform blocks per frame in flight followed by one camera block per frame in
+	// flight, mapped for the lifetime of the buffer
+	uint32_t framesInFlight = 2;
+	uint32_t currentFrame = 0;
+	VkBuffer uniformBuffer;
+	Allocation uniformBufferAllocation;
+	char* uniformBufferMapped = nullptr;
+	VkDeviceSize uniformStride;
+	VkDeviceSize uniformSliceSize;
+	VkDeviceSize cameraStride;
+	VkDeviceSize cameraOffset;
+	VkDeviceSize uniformBufferSize;
+
+	// per frame in flight, entities moved since that frame's slice was last written, replayed from entities when the
+	// frame comes around again so the mapped memory is never read back
+	std::vector<std::vector<uint32_t>> staleModelMatrices;
 
 	std::vector<VkCommandBuffer> commandBuffers;
 
-	VkSemaphore imageAvailableSemaphore;
-	VkSemaphore renderFinishedSemaphore;
+	// used instead of commandBuffers when recording every frame, one transient pool per frame in flight
+	std::vector<VkCommandPool> frameCommandPools;
+	std::vector<VkCommandBuffer> frameCommandBuffers;
+
+	std::vector<VkSemaphore> imageAvailableSemaphores;
+	std::vector<VkSemaphore> renderFinishedSemaphores;
+	std::vector<VkFence> inFlightFences;
 
 	VkImageView textureImageView;
 	VkSampler textureSampler;
 
 	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
+	Allocation depthImageAllocation;
 	VkImageView depthImageView;
 
 	void initWindow();
 	void initVulkan();
+	void initHeadless();
 	void mainLoop();
+	void headlessLoop();
+	void offscreenLoop();
 	void cleanupSwapChain();
 	void cleanup();
 	void recreateSwapChain();
@@ -106,35 +180,45 @@ protected:
 	void pickPhysicalDevice();
 	void createLogicalDevice();
 	void createSwapChain();
+	void createOffscreenTargets();
 	void createImageViews();
 	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
 	void createRenderPass();
 	void createDescriptorSetLayout();
+	void createPipelineCache();
+	void savePipelineCache();
 	void createGraphicsPipeline();
 	void createFramebuffers();
 	void createCommandPool();
 	void createDepthResources();
 	void createTextureImage();
 	void createTextureImageViews();
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageAllocation);
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 	void createTextureSampler();
 	void createVertexBuffer();
 	void createIndexBuffer();
-	void createUniformBuffer(Model& model);
+	void layoutUniformBuffer(VkDeviceSize alignment);
+	void createUniformBuffer();
+	void resetModelMatrices();
+	void createDrawBatches();
 	void createDescriptorPool();
-	void createDescriptorSet(Model& model);
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	void createDescriptorSet();
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation);
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 	void createCommandBuffers();
-	void createSemaphores();
-	void updateUniformBuffers(const UniformBufferObject& ubo);
-	void updateModelMatrix(const Model& model);
+	void createFrameCommandBuffers();
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex);
+	void createSyncObjects();
+	void createTimestampQueryPool();
+	void readTimestamps(uint32_t frame);
+	void updateCameraBlocks(const CameraBlock& camera);
+	VkCommandBuffer prepareCommandBuffer(uint32_t imageIndex);
 	void drawFrame();
+	void drawOffscreenFrame();
+	void captureImage(VkImage image, const std::string& path);
+	void advanceFrame();
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 	VkFormat findDepthFormat();
 	bool hasStencilComponent(VkFormat format);
@@ -149,9 +233,37 @@ protected:
 	std::vector<const char*> getRequiredExtensions();
 	bool checkValidationLayerSupport();
 
+	bool recordsEveryFrame() const {
+		return recordEveryFrame || renderMode == RenderMode::PushConstants;
+	}
+
+	void updateModelMatrix(size_t entity) {
+		if (renderMode == RenderMode::PushConstants) {
+			return;
+		}
+
+		writeModelMatrix(currentFrame, entity);
+
+		for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+			if (frame != currentFrame) {
+				staleModelMatrices[frame].push_back((uint32_t) entity);
+			}
+		}
+	}
+
+	// model matrices are pure translations, so only their last column is rewritten
+	void writeModelMatrix(uint32_t frame, size_t entity) {
+		const glm::vec3 origin = glm::vec3{entities.x[entity], entities.y[entity], entities.z[entity]} - models[entities.model[entity]].size / 2.0f;
+		const glm::vec4 translation {origin, 1.0f};
+		memcpy(uniformBufferMapped + frame * uniformSliceSize + entity * uniformStride + offsetof(UniformBufferObject, model) + 3 * sizeof(glm::vec4), &translation, sizeof(translation));
+	}
+
+	virtual bool parseArgument(const std::string& arg);
 	virtual void setup() {};
 	virtual void loadModel() = 0;
 	virtual void tick(float duration) {};
+	// alpha is how far the accumulator is into the next tick, for games that interpolate between tick states
+	virtual void render(float alpha) {};
 	virtual void updateCamera() {};
 	virtual void onKeyDown(int key, int scancode, int mods) {};
 	virtual void onKeyUp(int key, int scancode, int mods) {};
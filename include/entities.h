@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// per-entity state kept in parallel arrays so simulation loops only touch the fields they read
+struct Entities {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+	std::vector<uint8_t> alive;
+
+	// index into Engine::models of the mesh each entity is drawn with
+	std::vector<uint32_t> model;
+
+	size_t size() const {
+		return model.size();
+	}
+
+	void clear() {
+		*this = {};
+	}
+
+	size_t add(uint32_t modelIndex, float entityRadius) {
+		x.push_back(0);
+		y.push_back(0);
+		z.push_back(0);
+		radius.push_back(entityRadius);
+		alive.push_back(0);
+		model.push_back(modelIndex);
+
+		return model.size() - 1;
+	}
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Uniform grid over the xy plane. Entries are bucketed by cell with a counting sort, so a rebuild is two linear
+// passes and a query only touches the 3x3 block of cells around the query point. For a query to find every entry
+// within distance r of a point, cellSize must be at least r.
+struct UniformGrid {
+	float cellSize;
+	glm::vec2 origin;
+	int width = 0;
+	int height = 0;
+
+	std::vector<uint32_t> cellStart;
+	std::vector<uint32_t> entries;
+
+	void build(float size, const std::vector<glm::vec2>& points) {
+		cellSize = size;
+		width = height = 0;
+		entries.resize(points.size());
+
+		if (points.empty()) {
+			return;
+		}
+
+		glm::vec2 lower = points[0];
+		glm::vec2 upper = points[0];
+
+		for (const glm::vec2& p : points) {
+			lower = { std::min(lower.x, p.x), std::min(lower.y, p.y) };
+			upper = { std::max(upper.x, p.x), std::max(upper.y, p.y) };
+		}
+
+		origin = lower;
+		width = (int) ((upper.x - lower.x) / cellSize) + 1;
+		height = (int) ((upper.y - lower.y) / cellSize) + 1;
+
+		cellStart.assign(width * height + 1, 0);
+
+		for (const glm::vec2& p : points) {
+			cellStart[cellOf(p) + 1]++;
+		}
+
+		for (size_t i = 1; i < cellStart.size(); ++i) {
+			cellStart[i] += cellStart[i - 1];
+		}
+
+		std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+
+		for (uint32_t i = 0; i < points.size(); ++i) {
+			entries[cursor[cellOf(points[i])]++] = i;
+		}
+	}
+
+	template<typename Visitor>
+	void query(const glm::vec2& p, Visitor visit) const {
+		queryRanges(p, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i) {
+				visit(entries[i]);
+			}
+		});
+	}
+
+	// visits the neighbourhood of p as up to three [begin, end) ranges of entries, one per row of cells
+	template<typename Visitor>
+	void queryRanges(const glm::vec2& p, Visitor visit) const {
+		const float fx = std::floor((p.x - origin.x) / cellSize);
+		const float fy = std::floor((p.y - origin.y) / cellSize);
+
+		if (fx < -1 || fy < -1 || fx > width || fy > height) {
+			return;
+		}
+
+		const int x0 = std::max((int) fx - 1, 0), x1 = std::min((int) fx + 1, width - 1);
+		const int y0 = std::max((int) fy - 1, 0), y1 = std::min((int) fy + 1, height - 1);
+
+		for (int y = y0; y <= y1; ++y) {
+			visit(cellStart[y * width + x0], cellStart[y * width + x1 + 1]);
+		}
+	}
+
+	int cellOf(const glm::vec2& p) const {
+		return (int) ((p.y - origin.y) / cellSize) * width + (int) ((p.x - origin.x) / cellSize);
+	}
+};
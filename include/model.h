@@ -2,17 +2,18 @@
 
 #include <glm/glm.hpp>
 
+// a mesh in the shared vertex/index buffers, drawn once per entity that references it
 struct Model {
-	VkDescriptorSet descriptorSet;
-	VkBuffer uniformBuffer;
-	VkDeviceMemory uniformBufferMemory;
-
-	glm::mat4 modelMatrix;
-	
-	glm::vec3 position;
 	glm::vec3 size;
 	float radius;
 
 	uint32_t indexCount;
 	uint32_t firstIndex;
 };
+
+struct DrawBatch {
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
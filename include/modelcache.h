@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "vertex.h"
+#include "model.h"
+
+// Binary image of the parsed models file: a header, one ModelCacheEntry per model, then the vertex and index
+// arrays. Bump MODEL_CACHE_VERSION whenever the layout of any of these or the way meshes are generated changes.
+constexpr uint32_t MODEL_CACHE_MAGIC = 0x43444f4d; // "MODC"
+constexpr uint32_t MODEL_CACHE_VERSION = 2;
+
+struct ModelCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexSize;
+	uint32_t modelSize;
+
+	// the source file the cache was cooked from, a mismatch marks the cache stale
+	uint64_t sourceSize;
+	int64_t sourceModified;
+
+	uint32_t modelCount;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t padding;
+};
+
+struct ModelCacheEntry {
+	char name[32];
+	uint32_t count;
+	Model model;
+};
+
+// A read-only memory mapping of a cooked cache. The arrays point into the mapping and are valid until it is closed.
+class ModelCache {
+public:
+	const ModelCacheEntry* entries = nullptr;
+	const Vertex* vertices = nullptr;
+	const uint32_t* indices = nullptr;
+
+	uint32_t modelCount = 0;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+
+	ModelCache() = default;
+	ModelCache(const ModelCache&) = delete;
+	ModelCache& operator=(const ModelCache&) = delete;
+
+	~ModelCache() {
+		close();
+	}
+
+	// returns false if the cache is missing, malformed, from another version or older than sourcePath
+	bool open(const std::string& path, const std::string& sourcePath);
+	void close();
+
+	static void write(const std::string& path, const std::string& sourcePath, const std::vector<ModelCacheEntry>& entries, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+private:
+	void* mapping = nullptr;
+	size_t mappingSize = 0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+// CPU spans of one frame (or one tick when headless) in milliseconds, gpu is negative until its timestamps are read back
+struct FrameRecord {
+	uint32_t ticks = 0;
+	double tick = 0;
+	double acquire = 0;
+	double drawFrame = 0;
+	double present = 0;
+	double gpu = -1;
+};
+
+struct FrameProfiler {
+	typedef std::chrono::high_resolution_clock Clock;
+
+	std::vector<FrameRecord> records;
+
+	static double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - start).count();
+	}
+
+	void writeCsv(const std::string& filename) const {
+		std::ofstream file(filename);
+
+		if (!file) {
+			throw std::runtime_error("failed to open file '" + filename + "'!");
+		}
+
+		file << "frame,ticks,tick_ms,acquire_ms,draw_frame_ms,present_ms,gpu_ms\n";
+
+		for (size_t i = 0; i < records.size(); i++) {
+			const FrameRecord& r = records[i];
+
+			file << i << ',' << r.ticks << ',' << r.tick << ',' << r.acquire << ',' << r.drawFrame << ',' << r.present << ',';
+
+			if (r.gpu >= 0) {
+				file << r.gpu;
+			}
+
+			file << '\n';
+		}
+	}
+};
@@ -0,0 +1,693 @@
+#pragma once
+
+#include "engine.h"
+#include "grid.h"
+#include "collision.h"
+#include "modelcache.h"
+#include "welder.h"
+
+#include <random>
+
+constexpr size_t SPACING = 20;
+constexpr size_t FORMATION_WIDTH = 11;
+
+const std::string MODELS_PATH = "models/models.txt";
+const std::string MODEL_CACHE_PATH = "models/models.cache";
+
+constexpr int TICK_RATE = 60;
+constexpr float TEXTURE_WIDTH = 32 * 4;
+
+constexpr int PLAYER_MOVE_TICKS = TICK_RATE / 30;
+constexpr int PLAYER_MOVE_SPEED = 2;
+
+constexpr int BULLET_TICKS = TICK_RATE / 30;
+constexpr int BULLET_SPEED = 3;
+
+constexpr int MOB_MOVE_TICKS = TICK_RATE / 5;
+constexpr int MOB_ANIMATION_WIDTH = SPACING;
+
+constexpr int BOSS_MOVE_TICKS = TICK_RATE / 30;
+constexpr int BOSS_ANIMATION_WIDTH = SPACING * 10;
+
+constexpr float SHOOTING_PERCENTAGE_CHANCE = 0.001;
+
+enum class AnimationState {
+	Right, Left, Down1, Down2
+};
+
+class SpaceInvaders : public Engine {
+public:
+	SpaceInvaders() {
+		tickDuration = 1.0f / TICK_RATE;
+	}
+
+	// --cook-models parses models.txt and writes the binary cache instead of starting the game
+	bool cookOnly = false;
+
+	void cookModels() {
+		vertices = {};
+		indices = {};
+		models = {};
+		modelNames = {};
+		modelCounts = {};
+
+		parseModels(true);
+
+		std::vector<ModelCacheEntry> entries(models.size());
+
+		for (size_t i=0; i<models.size(); ++i) {
+			if (modelNames[i].size() >= sizeof(entries[i].name)) {
+				throw std::runtime_error("model name '" + modelNames[i] + "' is too long to cache");
+			}
+
+			std::strncpy(entries[i].name, modelNames[i].c_str(), sizeof(entries[i].name));
+			entries[i].count = (uint32_t) modelCounts[i];
+			entries[i].model = models[i];
+		}
+
+		ModelCache::write(MODEL_CACHE_PATH, MODELS_PATH, entries, vertices, indices);
+
+		std::cout << "merged " << meshCells << " cells into " << indices.size() / 6 << " quads: "
+			<< meshCellVertices << " -> " << vertices.size() << " vertices, "
+			<< meshCells * 6 << " -> " << indices.size() << " indices" << std::endl;
+
+		std::cout << "cooked " << models.size() << " models, " << vertices.size() << " vertices and " << indices.size() << " indices into '" << MODEL_CACHE_PATH << "'" << std::endl;
+	}
+
+protected:
+	size_t playerIndex;
+	size_t playerBulletIndex;
+	size_t playerBulletCount;
+
+	size_t enemyBulletIndex;
+	size_t enemyBulletCount;
+
+	size_t bossIndex;
+
+	size_t enemy1Index;
+	size_t enemy2Index;
+	size_t enemy3Index;
+
+	size_t enemy1Count;
+	size_t enemy2Count;
+	size_t enemy3Count;
+
+	// all mobs are spawned contiguously, enemy_1 first
+	size_t mobIndex;
+	size_t mobCount;
+
+	size_t playerCurrentBullet = 0;
+	size_t enemyCurrentBullet = 0;
+	int moveDirection = 0;
+
+	int playerMoveTicks = 0;
+
+	AnimationState mobState = AnimationState::Right;
+	int mobStateCounter = MOB_ANIMATION_WIDTH / 2;
+	int mobStateTicks = 0;
+
+	AnimationState bossState = AnimationState::Left;
+	int bossStateCounter = BOSS_ANIMATION_WIDTH / 2;
+	int bossStateTicks = 0;
+
+	int bulletTicks = 0;
+
+	std::vector<glm::vec2> mobPositions;
+	UniformGrid mobGrid;
+
+	// mob state copied into grid order and padded by COLLISION_LANES for sphereHitMask, dead mobs have radius 0
+	std::vector<float> mobGridX;
+	std::vector<float> mobGridY;
+	std::vector<float> mobGridZ;
+	std::vector<float> mobGridRadius;
+	float mobRadius = 0;
+
+	// filled cells seen by the last parseModels(true) and the distinct vertices they would have needed as one quad each
+	size_t meshCells = 0;
+	size_t meshCellVertices = 0;
+
+	// name and instance count of each entry in models, as listed in models.txt
+	std::vector<std::string> modelNames;
+	std::vector<size_t> modelCounts;
+
+	// multiplies the mob counts read from models.txt, for stress tests and benchmarks
+	uint32_t waveScale = 1;
+
+	std::mt19937 rng { std::random_device{}() };
+
+	bool parseArgument(const std::string& arg) {
+		if (arg.compare(0, 7, "--seed=") == 0) {
+			rng.seed((std::mt19937::result_type) std::stoul(arg.substr(7)));
+			return true;
+		}
+
+		if (arg == "--cook-models") {
+			cookOnly = true;
+			return true;
+		}
+
+		if (arg.compare(0, 13, "--wave-scale=") == 0) {
+			waveScale = (uint32_t) std::stoul(arg.substr(13));
+
+			if (waveScale == 0) {
+				throw std::runtime_error("wave scale must be at least 1!");
+			}
+
+			return true;
+		}
+
+		return Engine::parseArgument(arg);
+	}
+
+	void onKeyDown(int key, int scancode, int mods) {
+		switch (key) {
+			case GLFW_KEY_LEFT:
+				moveDirection = -1;
+				break;
+
+			case GLFW_KEY_RIGHT:
+				moveDirection = 1;
+				break;
+
+			case GLFW_KEY_UP:
+			case GLFW_KEY_SPACE:
+				shoot(playerIndex, playerBulletIndex, playerBulletCount, playerCurrentBullet);
+		}
+	};
+
+	void onKeyUp(int key, int scancode, int mods) {
+		switch (key) {
+			case GLFW_KEY_LEFT:
+				if (moveDirection == -1) {
+					moveDirection = 0;
+				}
+				break;
+
+			case GLFW_KEY_RIGHT:
+				if (moveDirection == 1) {
+					moveDirection = 0;
+				}
+				break;
+		}
+	};
+
+	glm::vec3 getEntityPos(size_t index) {
+		return {entities.x[index], entities.y[index], entities.z[index]};
+	}
+
+	void setEntityPos(size_t index, const glm::vec3& pos) {
+		entities.x[index] = pos.x;
+		entities.y[index] = pos.y;
+		entities.z[index] = pos.z;
+		updateModelMatrix(index);
+	}
+
+	void translateEntities(size_t first, size_t count, const glm::vec3& delta) {
+		for (size_t i=first; i<first+count; ++i) {
+			entities.x[i] += delta.x;
+			entities.y[i] += delta.y;
+			entities.z[i] += delta.z;
+		}
+
+		for (size_t i=first; i<first+count; ++i) {
+			updateModelMatrix(i);
+		}
+	}
+
+	bool inBounds(size_t index) {
+		return entities.y[index] <= 95 && entities.y[index] >= -55 && entities.z[index] >= 0;
+	}
+
+	void shoot(size_t shooterIndex, size_t bulletIndex, size_t bulletCount, size_t& currentBullet) {
+		if (!inBounds(bulletIndex + currentBullet)) { // out of bounds
+			setEntityPos(bulletIndex + currentBullet, getEntityPos(shooterIndex) + glm::vec3{0,0,1});
+			entities.alive[bulletIndex + currentBullet] = 1;
+			currentBullet = (currentBullet + 1) % bulletCount;
+		}
+	}
+
+	bool collides(size_t bulletIndex, size_t targetIndex) {
+		if (!entities.alive[bulletIndex] || !entities.alive[targetIndex]) {
+			return false;
+		}
+
+		const float dx = entities.x[bulletIndex] - entities.x[targetIndex];
+		const float dy = entities.y[bulletIndex] - entities.y[targetIndex];
+		const float dz = entities.z[bulletIndex] - 1 - entities.z[targetIndex];
+
+		return dx * dx + dy * dy + dz * dz < entities.radius[targetIndex] * entities.radius[targetIndex];
+	}
+
+	void resolveCollision(size_t bulletIndex, size_t targetIndex) {
+		setEntityPos(bulletIndex, {0, 0, -100000});
+		setEntityPos(targetIndex, {0, 0, 100000});
+		entities.alive[bulletIndex] = 0;
+		entities.alive[targetIndex] = 0;
+	}
+
+	bool detectCollision(size_t bulletIndex, size_t targetIndex) {
+		if (collides(bulletIndex, targetIndex)) {
+			resolveCollision(bulletIndex, targetIndex);
+			return true;
+		}
+
+		return false;
+	}
+
+	void buildMobGrid() {
+		mobPositions.resize(mobCount);
+
+		for (size_t i=0; i<mobCount; ++i) {
+			mobPositions[i] = {entities.x[mobIndex + i], entities.y[mobIndex + i]};
+		}
+
+		mobGrid.build(std::max((float) SPACING, mobRadius), mobPositions);
+
+		mobGridX.assign(mobCount + COLLISION_LANES, 0);
+		mobGridY.assign(mobCount + COLLISION_LANES, 0);
+		mobGridZ.assign(mobCount + COLLISION_LANES, 0);
+		mobGridRadius.assign(mobCount + COLLISION_LANES, 0);
+
+		for (size_t i=0; i<mobCount; ++i) {
+			const size_t mob = mobIndex + mobGrid.entries[i];
+
+			mobGridX[i] = entities.x[mob];
+			mobGridY[i] = entities.y[mob];
+			mobGridZ[i] = entities.z[mob];
+			mobGridRadius[i] = entities.alive[mob] ? entities.radius[mob] : 0;
+		}
+	}
+
+	void detectCollisions() {
+		buildMobGrid();
+
+		for (size_t i=0; i<playerBulletCount; ++i) {
+			const size_t bulletIndex = playerBulletIndex + i;
+
+			if (!entities.alive[bulletIndex]) {
+				continue;
+			}
+
+			const float x = entities.x[bulletIndex];
+			const float y = entities.y[bulletIndex];
+			const float z = entities.z[bulletIndex] - 1;
+
+			// the first mob in formation order wins, as it did with the linear scan
+			uint32_t hit = mobCount;
+			uint32_t hitSlot = 0;
+
+			mobGrid.queryRanges({x, y}, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t slot=begin; slot<end; slot+=COLLISION_LANES) {
+					uint32_t mask = sphereHitMask(x, y, z, &mobGridX[slot], &mobGridY[slot], &mobGridZ[slot], &mobGridRadius[slot]);
+
+					if (end - slot < COLLISION_LANES) {
+						mask &= (1u << (end - slot)) - 1;
+					}
+
+					for (; mask != 0; mask &= mask - 1) {
+						const uint32_t lane = slot + __builtin_ctz(mask);
+
+						if (mobGrid.entries[lane] < hit) {
+							hit = mobGrid.entries[lane];
+							hitSlot = lane;
+						}
+					}
+				}
+			});
+
+			if (hit < mobCount) {
+				mobGridRadius[hitSlot] = 0;
+				resolveCollision(bulletIndex, mobIndex + hit);
+			}
+
+			detectCollision(bulletIndex, bossIndex);
+		}
+
+		for (size_t i=0; i<enemyBulletCount; ++i) {
+			if (detectCollision(enemyBulletIndex + i, playerIndex)) {
+				//TODO: gameover
+				running = false;
+				break;
+			}
+		}
+	}
+
+	void doMobMove() {
+		glm::vec3 mobDir = (mobState == AnimationState::Right) ? glm::vec3{1,0,0}
+							: (mobState == AnimationState::Left) ? glm::vec3{-1,0,0}
+							: glm::vec3{0,-1,0};
+
+		translateEntities(mobIndex, mobCount, mobDir);
+	}
+
+	void doBossMove() {
+		glm::vec3 bossDir = bossState == AnimationState::Right ? glm::vec3{1,0,0} : glm::vec3{-1,0,0};
+		translateEntities(bossIndex, 1, bossDir);
+	}
+
+	void doPlayerAnimation() {
+		if (--playerMoveTicks < 0) {
+			playerMoveTicks += PLAYER_MOVE_TICKS;
+
+			translateEntities(playerIndex, 1, glm::vec3{1,0,0} * float(PLAYER_MOVE_SPEED * moveDirection));
+		}
+	}
+
+	void doMobAnimation() {
+		if (--mobStateTicks < 0) {
+			mobStateTicks += MOB_MOVE_TICKS;
+			doMobMove();
+
+			--mobStateCounter;
+
+			if (mobStateCounter <= 0) {
+				switch (mobState) {
+					case AnimationState::Right:
+						mobState = AnimationState::Down1;
+						mobStateCounter += MOB_ANIMATION_WIDTH / 4;
+						break;
+
+					case AnimationState::Left:
+						mobState = AnimationState::Down2;
+						mobStateCounter += MOB_ANIMATION_WIDTH / 4;
+						break;
+
+					case AnimationState::Down1:
+						mobState = AnimationState::Left;
+						mobStateCounter += MOB_ANIMATION_WIDTH;
+						break;
+
+					case AnimationState::Down2:
+						mobState = AnimationState::Right;
+						mobStateCounter += MOB_ANIMATION_WIDTH;
+						break;
+				}
+			}
+		}
+	}
+
+	void doBossAnimation() {
+		if (--bossStateTicks < 0) {
+			bossStateTicks += BOSS_MOVE_TICKS;
+			doBossMove();
+
+			--bossStateCounter;
+
+			if (bossStateCounter <= 0) {
+				bossStateCounter += BOSS_ANIMATION_WIDTH;
+
+				bossState = (bossState == AnimationState::Left) ? AnimationState::Right : AnimationState::Left;
+			}
+		}
+	}
+
+	void doBulletAnimation() {
+		if (--bulletTicks < 0) {
+			bulletTicks += BULLET_TICKS;
+
+			translateEntities(playerBulletIndex, playerBulletCount, glm::vec3{0,1,0} * float(BULLET_SPEED));
+			translateEntities(enemyBulletIndex, enemyBulletCount, glm::vec3{0,-1,0} * float(BULLET_SPEED));
+
+			// bullets leaving the play area are neither drawn nor collision tested anymore
+			for (size_t i=playerBulletIndex; i<playerBulletIndex+playerBulletCount; ++i) {
+				if (entities.alive[i] && !inBounds(i)) {
+					entities.alive[i] = 0;
+				}
+			}
+
+			for (size_t i=enemyBulletIndex; i<enemyBulletIndex+enemyBulletCount; ++i) {
+				if (entities.alive[i] && !inBounds(i)) {
+					entities.alive[i] = 0;
+				}
+			}
+		}
+	}
+
+	void doAnimation() {
+		doPlayerAnimation();
+		doMobAnimation();
+		doBossAnimation();
+		doBulletAnimation();
+	}
+
+	void doRandomShooting() {
+		static std::uniform_real_distribution<> dis(0.0, 1.0);
+
+		for (size_t i=mobIndex; i<mobIndex+mobCount; ++i) {
+			if (entities.alive[i] && inBounds(i) && dis(rng) < SHOOTING_PERCENTAGE_CHANCE) {
+				shoot(i, enemyBulletIndex, enemyBulletCount, enemyCurrentBullet);
+			}
+		}
+	}
+
+	void tick(float duration) {
+		detectCollisions();
+
+		doAnimation();
+		doRandomShooting();
+	}
+
+	// alpha is deliberately unused: everything moves in whole steps on tick boundaries like the arcade original, and
+	// blending would mean rewriting the matrix of every moving entity each frame instead of only when it steps
+	void render(float alpha) {
+		#ifndef NDEBUG
+		measureFramerate();
+		#endif
+	}
+
+	void updateCamera() {
+		CameraBlock camera;
+		camera.view = glm::lookAt(glm::vec3(SPACING * 5, -10.0f, 200.0f), glm::vec3(SPACING * 5, 20.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		camera.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 1000.0f);
+		camera.proj[1][1] *= -1;
+		updateCameraBlocks(camera);
+	}
+
+	size_t placeFormation(size_t index, size_t count, size_t row) {
+		for (size_t i=0; i<count; ++i) {
+			setEntityPos(index+i, {i % FORMATION_WIDTH * SPACING, (row + i / FORMATION_WIDTH) * SPACING, 0});
+		}
+
+		return row + (count + FORMATION_WIDTH - 1) / FORMATION_WIDTH;
+	}
+
+	void setup() {
+		updateCamera();
+
+		setEntityPos(playerIndex, {5 * SPACING, -50, 0});
+
+		for (size_t i=0; i<playerBulletCount; ++i) {
+			setEntityPos(playerBulletIndex + i, {0, 0, -100000});
+		}
+
+		for (size_t i=0; i<enemyBulletCount; ++i) {
+			setEntityPos(enemyBulletIndex + i, {0, 0, -100000});
+		}
+
+		size_t rows = 0;
+		rows = placeFormation(enemy1Index, enemy1Count, rows);
+		rows = placeFormation(enemy2Index, enemy2Count, rows);
+		rows = placeFormation(enemy3Index, enemy3Count, rows);
+
+		setEntityPos(bossIndex, {5 * SPACING, rows * SPACING, 0});
+
+		entities.alive[playerIndex] = 1;
+		entities.alive[bossIndex] = 1;
+
+		for (size_t i=mobIndex; i<mobIndex+mobCount; ++i) {
+			entities.alive[i] = 1;
+		}
+	}
+
+	void addVertex(const Vertex& v, VertexWelder& welder) {
+		indices.push_back(welder.insert(v));
+	}
+
+	size_t spawn(const std::string& name, size_t& count, uint32_t scale = 1) {
+		auto type = std::find(modelNames.begin(), modelNames.end(), name);
+
+		if (type == modelNames.end()) {
+			throw std::runtime_error("missing model '" + name + "'");
+		}
+
+		const uint32_t modelIndex = (uint32_t) (type - modelNames.begin());
+		const size_t first = entities.size();
+		count = modelCounts[modelIndex] * scale;
+
+		for (size_t i=0; i<count; ++i) {
+			entities.add(modelIndex, models[modelIndex].radius);
+		}
+
+		return first;
+	}
+
+	bool loadModelCache() {
+		ModelCache cache;
+
+		if (!cache.open(MODEL_CACHE_PATH, MODELS_PATH)) {
+			return false;
+		}
+
+		for (uint32_t i=0; i<cache.modelCount; ++i) {
+			modelNames.push_back(cache.entries[i].name);
+			modelCounts.push_back(cache.entries[i].count);
+			models.push_back(cache.entries[i].model);
+		}
+
+		vertices.assign(cache.vertices, cache.vertices + cache.vertexCount);
+		indices.assign(cache.indices, cache.indices + cache.indexCount);
+
+		return true;
+	}
+
+	// countCells also welds every cell as its own quad for the statistics cookModels prints, which is skipped at load
+	void parseModels(bool countCells = false) {
+		std::ifstream modelsFile(MODELS_PATH, std::ios::ate);
+
+		if (!modelsFile) {
+			throw std::runtime_error("failed to open file '" + MODELS_PATH + "'!");
+		}
+
+		// each run of filled cells adds at most four distinct vertices and takes at least one byte of the file
+		const size_t fileSize = (size_t) modelsFile.tellg();
+		modelsFile.seekg(0);
+
+		VertexWelder welder(vertices);
+		welder.reserve(fileSize * 4);
+
+		meshCells = 0;
+		std::vector<Vertex> cellVertices;
+		VertexWelder cellWelder(cellVertices);
+
+		const std::set<std::string> knownModels {"player", "player_bullet", "enemy_bullet", "boss", "enemy_1", "enemy_2", "enemy_3"};
+
+		size_t textureCount;
+		modelsFile >> textureCount;
+
+		std::string modelName;
+		uint32_t height, count, textureId;
+		while (modelsFile >> modelName >> height >> textureId >> count) {
+			double textureBase = (double) textureId / textureCount;
+			double nextTextureBase = (double) (textureId + 1) / textureCount - 1 / TEXTURE_WIDTH;
+
+			if (knownModels.count(modelName) == 0) {
+				throw std::runtime_error("unknown model name '" + modelName + "'");
+			}
+
+			Model m {};
+			m.firstIndex = indices.size();
+			m.size[1] = height;
+
+			for (size_t i=height; i-- > 0; ) {
+				std::string line;
+				modelsFile >> line;
+
+				m.size[0] = std::max(m.size[0], (float) line.length());
+
+				// each horizontal run of filled cells becomes one quad, its v coordinate spans the run length so the
+				// repeating sampler still draws one tile per cell. the tile only covers part of the atlas in u, so
+				// runs on different rows can't be merged the same way.
+				for (size_t j=0; j<line.length(); ) {
+					if (line[j] == '.') {
+						++j;
+						continue;
+					}
+
+					size_t end = j;
+					while (end < line.length() && line[end] != '.') {
+						++end;
+					}
+
+					const float run = end - j;
+					const Vertex v1 {{j  , i     , 0.0f}, {1.0f, 1.0f, 1.0f}, {    textureBase,   0}};
+					const Vertex v2 {{end, i     , 0.0f}, {1.0f, 1.0f, 1.0f}, {    textureBase, run}};
+					const Vertex v3 {{end, i+1.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {nextTextureBase, run}};
+					const Vertex v4 {{j  , i+1.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {nextTextureBase,   0}};
+
+					addVertex(v1, welder);
+					addVertex(v2, welder);
+					addVertex(v4, welder);
+
+					addVertex(v2, welder);
+					addVertex(v3, welder);
+					addVertex(v4, welder);
+
+					m.indexCount += 6;
+
+					if (countCells) {
+						meshCells += end - j;
+
+						for (size_t k=j; k<end; ++k) {
+							cellWelder.insert(Vertex {{k     , i     , 0.0f}, {1.0f, 1.0f, 1.0f}, {    textureBase, 0}});
+							cellWelder.insert(Vertex {{k+1.0f, i     , 0.0f}, {1.0f, 1.0f, 1.0f}, {    textureBase, 1}});
+							cellWelder.insert(Vertex {{k+1.0f, i+1.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {nextTextureBase, 1}});
+							cellWelder.insert(Vertex {{k     , i+1.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {nextTextureBase, 0}});
+						}
+					}
+
+					j = end;
+				}
+			}
+
+			m.radius = glm::length(m.size) / 2;
+
+			modelNames.push_back(modelName);
+			modelCounts.push_back(count);
+			models.push_back(m);
+		}
+
+		meshCellVertices = cellVertices.size();
+	}
+
+	void loadModel() {
+		vertices = {};
+		indices = {};
+		models = {};
+		modelNames = {};
+		modelCounts = {};
+
+		// the text parser stays as the fallback for a missing or stale cache
+		if (!loadModelCache()) {
+			parseModels();
+		}
+
+		entities.clear();
+
+		size_t playerCount, bossCount;
+		playerIndex = spawn("player", playerCount);
+		playerBulletIndex = spawn("player_bullet", playerBulletCount);
+		enemyBulletIndex = spawn("enemy_bullet", enemyBulletCount);
+		bossIndex = spawn("boss", bossCount);
+		enemy1Index = spawn("enemy_1", enemy1Count, waveScale);
+		enemy2Index = spawn("enemy_2", enemy2Count, waveScale);
+		enemy3Index = spawn("enemy_3", enemy3Count, waveScale);
+
+		mobIndex = enemy1Index;
+		mobCount = enemy1Count + enemy2Count + enemy3Count;
+
+		for (size_t i=mobIndex; i<mobIndex+mobCount; ++i) {
+			mobRadius = std::max(mobRadius, entities.radius[i]);
+		}
+	}
+
+	void measureFramerate() {
+		static double frameRate = TICK_RATE;
+		static int frames = 0;
+		static auto previousTime = std::chrono::high_resolution_clock::now();
+
+		++frames;
+
+		auto currTime = std::chrono::high_resolution_clock::now();
+		double delta = std::chrono::duration<double, std::chrono::milliseconds::period>(currTime - previousTime).count();
+
+		if (delta > 1000.0f) {
+			frameRate = (double)frames*0.5f + frameRate*0.5f;
+			std::cout << "\rFrame rate was " << frames << " average is " << frameRate;
+			std::cout.flush();
+
+			frames = 0;
+			previousTime = currTime;
+		}
+
+	}
+};
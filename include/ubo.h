@@ -1,9 +1,38 @@
 #pragma once
 
+#include <array>
+
+#include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
-struct UniformBufferObject {
-	glm::mat4 model;
+// shared by every entity, one copy per frame in flight
+struct CameraBlock {
 	glm::mat4 view;
 	glm::mat4 proj;
 };
+
+struct UniformBufferObject {
+	glm::mat4 model;
+
+	static VkVertexInputBindingDescription getInstanceBindingDescription(uint32_t stride) {
+		VkVertexInputBindingDescription bindingDescription {};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = stride;
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 4> getInstanceAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions {};
+
+		for (uint32_t i = 0; i < attributeDescriptions.size(); i++) {
+			attributeDescriptions[i].binding = 1;
+			attributeDescriptions[i].location = 3 + i;
+			attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[i].offset = offsetof(UniformBufferObject, model) + i * sizeof(glm::vec4);
+		}
+
+		return attributeDescriptions;
+	}
+};
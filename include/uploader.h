@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "allocator.h"
+
+// Batches staging copies into submissions on a transfer capable queue, preferring a family without graphics support
+// when the device has one. Data is written into a persistently mapped staging ring as soon as an upload is queued, so
+// callers can release their copy right away. Each submitted batch holds its stretch of the ring until its fence
+// signals; when the ring runs full the oldest batches are waited on, so uploads at runtime stream through without
+// allocating. Uploads larger than the whole ring get a staging buffer of their own that is freed with their batch.
+// Resources written through the uploader must be created with queueFamilies() as concurrent owners when
+// usesDedicatedQueue(), and must not be read before the batch that wrote them has completed, which wait() ensures.
+class Uploader {
+public:
+	static constexpr VkDeviceSize RING_SIZE = 4 * 1024 * 1024;
+
+	void init(VkDevice device, DeviceAllocator& allocator, uint32_t graphicsFamily, uint32_t transferFamily, VkQueue transferQueue);
+	void destroy();
+
+	bool usesDedicatedQueue() const {
+		return families[0] != families[1];
+	}
+
+	const uint32_t* queueFamilies() const {
+		return families;
+	}
+
+	// returns size bytes of mapped staging memory that are copied to buffer at offset when the batch executes
+	char* stage(VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset = 0);
+	void uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+	// image must be in VK_IMAGE_LAYOUT_UNDEFINED and is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	void uploadImage(VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height);
+
+	void submit();
+	void wait();
+
+	// releases the ring space of batches that have already completed without blocking
+	void poll();
+
+private:
+	struct Staging {
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		char* mapped;
+	};
+
+	struct Batch {
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+		// ring bytes, including alignment and wrap padding, released when the batch completes
+		VkDeviceSize ringBytes;
+		// staging buffers of uploads that didn't fit in the ring, freed when the batch completes
+		std::vector<VkBuffer> oversizedBuffers;
+		std::vector<Allocation> oversizedAllocations;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceAllocator* allocator = nullptr;
+	uint32_t families[2] {};
+	VkQueue queue;
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<Batch> batches;
+	std::vector<size_t> freeBatches;
+	std::deque<size_t> pendingBatches;
+	size_t recordingBatch = SIZE_MAX;
+
+	VkBuffer ring = VK_NULL_HANDLE;
+	Allocation ringAllocation;
+	VkDeviceSize ringHead = 0;
+	VkDeviceSize ringUsed = 0;
+
+	Staging allocateStaging(VkDeviceSize size);
+	VkDeviceSize allocateRing(VkDeviceSize size);
+	void releaseOversized(Batch& batch);
+	void reclaimOldest();
+	VkCommandBuffer begin();
+};
@@ -1,16 +1,80 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
+// Building with -DPACKED_VERTICES stores positions as int16, color as unorm8 and texture coordinates as half floats,
+// 16 bytes per vertex instead of 32. The formats are expanded to floats by the input assembler, so the shaders are the
+// same for both layouts. Texture coordinates use half floats because v spans whole runs of cells and exceeds 1.
 struct Vertex {
+#ifdef PACKED_VERTICES
+    int16_t pos[4];
+    uint8_t color[4];
+    uint16_t texCoord[2];
+
+    static constexpr VkFormat POSITION_FORMAT = VK_FORMAT_R16G16B16A16_SSCALED;
+    static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    static constexpr VkFormat TEXCOORD_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+
+    Vertex() = default;
+
+    Vertex(const glm::vec3& p, const glm::vec3& c, const glm::vec2& t)
+        : pos { (int16_t) std::lround(p.x), (int16_t) std::lround(p.y), (int16_t) std::lround(p.z), 1 },
+          color { toUnorm8(c.x), toUnorm8(c.y), toUnorm8(c.z), 255 },
+          texCoord { toHalf(t.x), toHalf(t.y) } {}
+
+    static uint8_t toUnorm8(float f) {
+        return (uint8_t) std::lround(std::min(std::max(f, 0.0f), 1.0f) * 255.0f);
+    }
+
+    // rounds to nearest even, values too small for a normal half flush to zero
+    static uint16_t toHalf(float f) {
+        uint32_t x;
+        memcpy(&x, &f, sizeof(x));
+
+        const uint32_t sign = (x >> 16) & 0x8000;
+        const int32_t exponent = (int32_t) ((x >> 23) & 0xff) - 127 + 15;
+        const uint32_t mantissa = x & 0x7fffff;
+
+        if (exponent <= 0) {
+            return (uint16_t) sign;
+        }
+
+        if (exponent >= 31) {
+            return (uint16_t) (sign | 0x7c00);
+        }
+
+        uint32_t h = sign | ((uint32_t) exponent << 10) | (mantissa >> 13);
+
+        if ((mantissa & 0x1000) && ((mantissa & 0xfff) || (h & 1))) {
+            h++;
+        }
+
+        return (uint16_t) h;
+    }
+
+    bool operator== (const Vertex& other) const {
+        return memcmp(this, &other, sizeof(Vertex)) == 0;
+    }
+#else
     glm::vec3 pos;
     glm::vec3 color;
     glm::vec2 texCoord;
 
+    static constexpr VkFormat POSITION_FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+    static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+    static constexpr VkFormat TEXCOORD_FORMAT = VK_FORMAT_R32G32_SFLOAT;
+
+    bool operator== (const Vertex& other) const {
+	return pos == other.pos && color == other.color && texCoord == other.texCoord;
+    }
+#endif
+
     static VkVertexInputBindingDescription getBindingDescription() {
         VkVertexInputBindingDescription bindingDescription {};
         bindingDescription.binding = 0;
@@ -25,32 +89,20 @@ struct Vertex {
 
         attributeDescriptions[0].binding = 0;
         attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[0].format = POSITION_FORMAT;
         attributeDescriptions[0].offset = offsetof(Vertex, pos);
 
         attributeDescriptions[1].binding = 0;
         attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[1].format = COLOR_FORMAT;
         attributeDescriptions[1].offset = offsetof(Vertex, color);
 
         attributeDescriptions[2].binding = 0;
         attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[2].format = TEXCOORD_FORMAT;
         attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
 
         return attributeDescriptions;
     }
-
-    bool operator== (const Vertex& other) const {
-	return pos == other.pos && color == other.color && texCoord == other.texCoord;
-    }
 };
 
-namespace std {
-	template<> struct hash<Vertex> {
-		size_t operator() (Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
-		}
-	};
-}
-
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+#include "vertex.h"
+
+// Deduplicates vertices with an open addressing table of indices into a vertex array. Keys are hashed from the
+// vertex attributes quantized to 1/1024 (packed vertices are already quantized), which is finer than anything the
+// sprite meshes use, and compared exactly on a hash match, so distinct vertices are never merged.
+class VertexWelder {
+public:
+	explicit VertexWelder(std::vector<Vertex>& vertices) : vertices(vertices) {}
+
+	// sizes the table for count vertices so it never grows while they are inserted
+	void reserve(size_t count) {
+		size_t capacity = 16;
+		while (capacity < count * 2) {
+			capacity *= 2;
+		}
+
+		if (capacity > slots.size()) {
+			rehash(capacity);
+		}
+	}
+
+	// returns the index of v in the vertex array, appending it if no equal vertex has been inserted yet
+	uint32_t insert(const Vertex& v) {
+		if ((size + 1) * 2 > slots.size()) {
+			rehash(std::max<size_t>(16, slots.size() * 2));
+		}
+
+		for (size_t slot = hash(v) & (slots.size() - 1); ; slot = (slot + 1) & (slots.size() - 1)) {
+			if (slots[slot] == EMPTY) {
+				slots[slot] = (uint32_t) vertices.size();
+				vertices.push_back(v);
+				size++;
+
+				return slots[slot];
+			}
+
+			if (vertices[slots[slot]] == v) {
+				return slots[slot];
+			}
+		}
+	}
+
+private:
+	static constexpr uint32_t EMPTY = UINT32_MAX;
+
+	std::vector<Vertex>& vertices;
+	std::vector<uint32_t> slots;
+	size_t size = 0;
+
+#ifdef PACKED_VERTICES
+	static uint64_t quantize(uint32_t i) {
+		return i;
+	}
+
+	static size_t hash(const Vertex& v) {
+		const uint32_t components[] { (uint16_t) v.pos[0], (uint16_t) v.pos[1], (uint16_t) v.pos[2], v.color[0], v.color[1], v.color[2], v.texCoord[0], v.texCoord[1] };
+#else
+	static uint64_t quantize(float f) {
+		return (uint64_t) (uint32_t) (int32_t) std::lround(f * 1024.0f);
+	}
+
+	static size_t hash(const Vertex& v) {
+		const float components[] { v.pos.x, v.pos.y, v.pos.z, v.color.x, v.color.y, v.color.z, v.texCoord.x, v.texCoord.y };
+#endif
+
+		uint64_t h = 0x9e3779b97f4a7c15ull;
+		for (auto c : components) {
+			h = (h ^ quantize(c)) * 0xff51afd7ed558ccdull;
+			h ^= h >> 32;
+		}
+
+		return (size_t) h;
+	}
+
+	void rehash(size_t capacity) {
+		std::vector<uint32_t> old(capacity, EMPTY);
+		old.swap(slots);
+
+		for (uint32_t index : old) {
+			if (index == EMPTY) {
+				continue;
+			}
+
+			size_t slot = hash(vertices[index]) & (capacity - 1);
+			while (slots[slot] != EMPTY) {
+				slot = (slot + 1) & (capacity - 1);
+			}
+
+			slots[slot] = index;
+		}
+	}
+};
@@ -0,0 +1,216 @@
+#include "allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void DeviceAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device) {
+	this->device = device;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	pools.assign(memoryProperties.memoryTypeCount * 2, Pool {});
+}
+
+void DeviceAllocator::destroy() {
+	for (Pool& pool : pools) {
+		for (Block& block : pool.blocks) {
+			releaseBlock(block);
+		}
+	}
+
+	pools.clear();
+}
+
+Allocation DeviceAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+	const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+	const uint32_t poolIndex = memoryType * 2 + (linear ? 1 : 0);
+
+	Allocation allocation;
+	allocation.pool = poolIndex;
+
+	if (requirements.size <= BLOCK_SIZE) {
+		std::vector<Block>& blocks = pools[poolIndex].blocks;
+
+		for (uint32_t i = 0; i < blocks.size(); i++) {
+			if (blocks[i].memory != VK_NULL_HANDLE && blocks[i].size == BLOCK_SIZE && allocateFromBlock(blocks[i], requirements, allocation)) {
+				allocation.block = i;
+				return allocation;
+			}
+		}
+	}
+
+	allocation.block = createBlock(poolIndex, std::max(requirements.size, BLOCK_SIZE));
+
+	if (!allocateFromBlock(pools[poolIndex].blocks[allocation.block], requirements, allocation)) {
+		throw std::runtime_error("failed to sub-allocate device memory!");
+	}
+
+	return allocation;
+}
+
+void DeviceAllocator::free(Allocation& allocation) {
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	Block& block = pools[allocation.pool].blocks[allocation.block];
+	std::vector<Range>& ranges = block.freeRanges;
+
+	auto next = ranges.begin();
+	while (next != ranges.end() && next->offset < allocation.offset) {
+		++next;
+	}
+
+	next = ranges.insert(next, { allocation.offset, allocation.size });
+
+	if (next + 1 != ranges.end() && next->offset + next->size == (next + 1)->offset) {
+		next->size += (next + 1)->size;
+		ranges.erase(next + 1);
+	}
+
+	if (next != ranges.begin() && (next - 1)->offset + (next - 1)->size == next->offset) {
+		(next - 1)->size += next->size;
+		ranges.erase(next);
+	}
+
+	block.used -= allocation.size;
+	block.allocations--;
+
+	// dedicated blocks are not worth keeping around for reuse
+	if (block.allocations == 0 && block.size > BLOCK_SIZE) {
+		releaseBlock(block);
+	}
+
+	allocation = {};
+}
+
+void DeviceAllocator::printStatistics(std::ostream& out) const {
+	for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+		uint32_t blocks = 0, allocations = 0;
+		VkDeviceSize reserved = 0, used = 0;
+
+		for (uint32_t i = 0; i < pools.size(); i++) {
+			if (memoryProperties.memoryTypes[i / 2].heapIndex != heap) {
+				continue;
+			}
+
+			for (const Block& block : pools[i].blocks) {
+				if (block.memory != VK_NULL_HANDLE) {
+					blocks++;
+					allocations += block.allocations;
+					reserved += block.size;
+					used += block.used;
+				}
+			}
+		}
+
+		if (blocks > 0) {
+			out << "heap " << heap << ": " << blocks << " blocks, " << allocations << " allocations, "
+				<< used / 1024 << " of " << reserved / 1024 << " KiB used" << std::endl;
+		}
+	}
+
+	out << deviceAllocations << " device memory allocations made" << std::endl;
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool DeviceAllocator::allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, Allocation& allocation) {
+	for (size_t i = 0; i < block.freeRanges.size(); i++) {
+		const Range range = block.freeRanges[i];
+		const VkDeviceSize offset = (range.offset + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+
+		if (offset + requirements.size > range.offset + range.size) {
+			continue;
+		}
+
+		// the alignment padding in front and the remainder behind stay free
+		std::vector<Range> remaining;
+
+		if (offset > range.offset) {
+			remaining.push_back({ range.offset, offset - range.offset });
+		}
+
+		if (offset + requirements.size < range.offset + range.size) {
+			remaining.push_back({ offset + requirements.size, range.offset + range.size - offset - requirements.size });
+		}
+
+		block.freeRanges.erase(block.freeRanges.begin() + i);
+		block.freeRanges.insert(block.freeRanges.begin() + i, remaining.begin(), remaining.end());
+
+		block.used += requirements.size;
+		block.allocations++;
+
+		allocation.memory = block.memory;
+		allocation.offset = offset;
+		allocation.size = requirements.size;
+		allocation.mapped = block.mapped != nullptr ? block.mapped + offset : nullptr;
+
+		return true;
+	}
+
+	return false;
+}
+
+uint32_t DeviceAllocator::createBlock(uint32_t poolIndex, VkDeviceSize size) {
+	const uint32_t memoryType = poolIndex / 2;
+
+	VkMemoryAllocateInfo allocInfo {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	Block block;
+	block.size = size;
+	block.freeRanges.push_back({ 0, size });
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate device memory block!");
+	}
+
+	deviceAllocations++;
+
+	if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		void* data;
+
+		if (vkMapMemory(device, block.memory, 0, size, 0, &data) != VK_SUCCESS) {
+			vkFreeMemory(device, block.memory, nullptr);
+			throw std::runtime_error("failed to map device memory block!");
+		}
+
+		block.mapped = static_cast<char*>(data);
+	}
+
+	// reuse the slot of a released dedicated block so indices held by live allocations stay valid
+	std::vector<Block>& blocks = pools[poolIndex].blocks;
+
+	for (uint32_t i = 0; i < blocks.size(); i++) {
+		if (blocks[i].memory == VK_NULL_HANDLE) {
+			blocks[i] = std::move(block);
+			return i;
+		}
+	}
+
+	blocks.push_back(std::move(block));
+	return (uint32_t) blocks.size() - 1;
+}
+
+void DeviceAllocator::releaseBlock(Block& block) {
+	if (block.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	if (block.mapped != nullptr) {
+		vkUnmapMemory(device, block.memory);
+	}
+
+	vkFreeMemory(device, block.memory, nullptr);
+	block = {};
+}
@@ -8,6 +8,20 @@ static const int HEIGHT = 600;
 
 static const std::string TEXTURE_PATH = "textures/texture.png";
 
+// kept next to the compiled shaders, so make clean throws it away together with them
+static const std::string PIPELINE_CACHE_PATH = "shaders/pipeline.cache";
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x48435050; // "PPCH"
+
+// written in front of the driver's cache data, which is only handed back to a device and driver matching it
+struct PipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+};
+
 static const std::vector<const char*> validationLayers { "VK_LAYER_LUNARG_standard_validation" };
 static const std::vector<const char*> deviceExtensions { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
@@ -51,12 +65,67 @@ static std::vector<char> readFile(const std::string& filename) {
 	return buffer;
 }
 
+void Engine::parseArguments(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (!parseArgument(argv[i])) {
+			throw std::runtime_error("unknown argument '" + std::string(argv[i]) + "'");
+		}
+	}
+}
+
+bool Engine::parseArgument(const std::string& arg) {
+	if (arg == "--render-mode=per-model") {
+		renderMode = RenderMode::PerModel;
+	} else if (arg == "--render-mode=instanced") {
+		renderMode = RenderMode::Instanced;
+	} else if (arg == "--render-mode=push-constants") {
+		renderMode = RenderMode::PushConstants;
+	} else if (arg == "--record-every-frame") {
+		recordEveryFrame = true;
+	} else if (arg == "--headless") {
+		headless = true;
+	} else if (arg == "--offscreen") {
+		offscreen = true;
+	} else if (arg.compare(0, 10, "--capture=") == 0) {
+		capturePath = arg.substr(10);
+	} else if (arg.compare(0, 8, "--ticks=") == 0) {
+		headlessTicks = std::stoull(arg.substr(8));
+	} else if (arg.compare(0, 10, "--profile=") == 0) {
+		profilePath = arg.substr(10);
+	} else if (arg.compare(0, 19, "--frames-in-flight=") == 0) {
+		framesInFlight = (uint32_t) std::stoul(arg.substr(19));
+
+		if (framesInFlight == 0) {
+			throw std::runtime_error("at least one frame in flight is required!");
+		}
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
 void Engine::run() {
-	initWindow();
-	initVulkan();
-	setup();
-	mainLoop();
-	cleanup();
+	if (headless) {
+		initHeadless();
+		setup();
+		headlessLoop();
+	} else if (offscreen) {
+		initVulkan();
+		setup();
+		offscreenLoop();
+		cleanup();
+	} else {
+		initWindow();
+		initVulkan();
+		setup();
+		mainLoop();
+		cleanup();
+	}
+
+	if (!profilePath.empty()) {
+		profiler.writeCsv(profilePath);
+	}
 }
 
 void Engine::initWindow() {
@@ -73,16 +142,33 @@ void Engine::initWindow() {
 
 void Engine::initVulkan() {
 	loadModel();
+	createDrawBatches();
 
 	createInstance();
 	setupDebugCallback();
-	createSurface();
+
+	if (!offscreen) {
+		createSurface();
+	}
+
 	pickPhysicalDevice();
 	createLogicalDevice();
-	createSwapChain();
+	allocator.init(physicalDevice, device);
+
+	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+	uploader.init(device, allocator, queueFamilyIndices.graphicsFamily, queueFamilyIndices.transferFamily, transferQueue);
+
+	if (offscreen) {
+		createOffscreenTargets();
+	} else {
+		createSwapChain();
+	}
+
 	createImageViews();
 	createRenderPass();
 	createDescriptorSetLayout();
+	createUniformBuffer();
+	createPipelineCache();
 	createGraphicsPipeline();
 	createCommandPool();
 	createDepthResources();
@@ -92,20 +178,65 @@ void Engine::initVulkan() {
 	createTextureSampler();
 	createVertexBuffer();
 	createIndexBuffer();
+
+	// the uploads run on the transfer queue while the rest of the device objects are created
+	uploader.submit();
+
 	createDescriptorPool();
-	
-	for (Model& model : models) {
-		createUniformBuffer(model);
-		createDescriptorSet(model);
-	}
+	createDescriptorSet();
 
+	createTimestampQueryPool();
 	createCommandBuffers();
-	createSemaphores();
+	createFrameCommandBuffers();
+	createSyncObjects();
+
+	uploader.wait();
+}
+
+void Engine::initHeadless() {
+	loadModel();
+
+	swapChainExtent = { WIDTH, HEIGHT };
+
+	// nothing is rendered, so there is no other frame whose slice would have to catch up on moved entities
+	framesInFlight = 1;
+
+	layoutUniformBuffer(256);
+	headlessUniformBuffer.assign(uniformBufferSize, 0);
+	uniformBufferMapped = headlessUniformBuffer.data();
+	resetModelMatrices();
+}
+
+void Engine::headlessLoop() {
+	running = true;
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	uint64_t ticks = 0;
+	while (running && (headlessTicks == 0 || ticks < headlessTicks)) {
+		if (profilePath.empty()) {
+			tick(tickDuration);
+		} else {
+			const auto tickStart = FrameProfiler::Clock::now();
+			tick(tickDuration);
+
+			profiler.records.emplace_back();
+			profiler.records.back().ticks = 1;
+			profiler.records.back().tick = FrameProfiler::millisecondsSince(tickStart);
+		}
+
+		ticks++;
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	const double elapsed = std::chrono::duration<double, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+	std::cout << "simulated " << ticks << " ticks (" << ticks * tickDuration << "s of game time) in " << elapsed << "ms" << std::endl;
 }
 
 void Engine::mainLoop() {
 	running = true;
-	auto lastTick = std::chrono::high_resolution_clock::now();
+	auto previousTime = std::chrono::high_resolution_clock::now();
+	double accumulator = 0;
 
 	while (running && !glfwWindowShouldClose(window)) {
 		if (needsResize) {
@@ -117,86 +248,209 @@ void Engine::mainLoop() {
 		glfwPollEvents();
 
 		const auto currTime = std::chrono::high_resolution_clock::now();
-		const float duration = std::chrono::duration<float, std::chrono::seconds::period>(currTime - lastTick).count();
-		lastTick = currTime;
-		tick(duration);
+		accumulator += std::chrono::duration<double, std::chrono::seconds::period>(currTime - previousTime).count();
+		previousTime = currTime;
+
+		if (!profilePath.empty()) {
+			profiler.records.emplace_back();
+		}
+
+		uint32_t ticks = 0;
+		for (; accumulator >= tickDuration && running; ticks++) {
+			if (ticks == maxTicksPerFrame) {
+				accumulator = std::fmod(accumulator, tickDuration);
+				break;
+			}
+
+			tick(tickDuration);
+			accumulator -= tickDuration;
+		}
+
+		if (!profilePath.empty()) {
+			profiler.records.back().ticks = ticks;
+			profiler.records.back().tick = FrameProfiler::millisecondsSince(currTime);
+		}
 
+		render((float) (accumulator / tickDuration));
+
+		const auto drawStart = FrameProfiler::Clock::now();
 		drawFrame();
 
+		if (!profilePath.empty()) {
+			profiler.records.back().drawFrame = FrameProfiler::millisecondsSince(drawStart);
+		}
 	}
 
 	vkDeviceWaitIdle(device);
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		readTimestamps(i);
+	}
+}
+
+void Engine::offscreenLoop() {
+	running = true;
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	uint64_t frames = 0;
+	while (running && (headlessTicks == 0 || frames < headlessTicks)) {
+		const auto tickStart = FrameProfiler::Clock::now();
+
+		if (!profilePath.empty()) {
+			profiler.records.emplace_back();
+		}
+
+		tick(tickDuration);
+
+		if (!profilePath.empty()) {
+			profiler.records.back().ticks = 1;
+			profiler.records.back().tick = FrameProfiler::millisecondsSince(tickStart);
+		}
+
+		render(0.0f);
+
+		const auto drawStart = FrameProfiler::Clock::now();
+		drawOffscreenFrame();
+
+		if (!profilePath.empty()) {
+			profiler.records.back().drawFrame = FrameProfiler::millisecondsSince(drawStart);
+		}
+
+		frames++;
+	}
+
+	vkDeviceWaitIdle(device);
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		readTimestamps(i);
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	const double elapsed = std::chrono::duration<double, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+	std::cout << "rendered " << frames << " frames offscreen in " << elapsed << "ms" << std::endl;
+
+	if (!capturePath.empty() && frames > 0) {
+		// advanceFrame has already moved past the image the last frame was rendered into
+		captureImage(swapChainImages[(currentFrame + framesInFlight - 1) % framesInFlight], capturePath);
+	}
 }
 
 void Engine::cleanupSwapChain() {
 	vkDestroyImageView(device, depthImageView, nullptr);
 	vkDestroyImage(device, depthImage, nullptr);
-	vkFreeMemory(device, depthImageMemory, nullptr);
+	allocator.free(depthImageAllocation);
 
 	for (auto framebuffer : swapChainFramebuffers) {
 		vkDestroyFramebuffer(device, framebuffer, nullptr);
 	}
 
-	vkFreeCommandBuffers(device, commandPool, (uint32_t) commandBuffers.size(), commandBuffers.data());
-
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+	if (!commandBuffers.empty()) {
+		vkFreeCommandBuffers(device, commandPool, (uint32_t) commandBuffers.size(), commandBuffers.data());
+	}
 
 	for (auto imageView : swapChainImageViews) {
 		vkDestroyImageView(device, imageView, nullptr);
 	}
-
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
 }
 
 void Engine::cleanup() {
 	cleanupSwapChain();
 
+	vkDestroyPipeline(device, graphicsPipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyRenderPass(device, renderPass, nullptr);
+
+	savePipelineCache();
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+
+	if (offscreen) {
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			vkDestroyImage(device, swapChainImages[i], nullptr);
+			allocator.free(offscreenImageAllocations[i]);
+		}
+	} else {
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+	}
+
 	vkDestroySampler(device, textureSampler, nullptr);
 	vkDestroyImageView(device, textureImageView, nullptr);
 
 	vkDestroyImage(device, textureImage, nullptr);
-	vkFreeMemory(device, textureImageMemory, nullptr);
+	allocator.free(textureImageAllocation);
 
 	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
-	for (const Model& model : models) {
-		vkDestroyBuffer(device, model.uniformBuffer, nullptr);
-		vkFreeMemory(device, model.uniformBufferMemory, nullptr);
-	}
+	vkDestroyBuffer(device, uniformBuffer, nullptr);
+	allocator.free(uniformBufferAllocation);
 
 	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device, indexBufferMemory, nullptr);
+	allocator.free(indexBufferAllocation);
 
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	allocator.free(vertexBufferAllocation);
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		vkDestroyFence(device, inFlightFences[i], nullptr);
+		vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
+		vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+	}
+
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	}
 
-	vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-	vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+	for (VkCommandPool pool : frameCommandPools) {
+		vkDestroyCommandPool(device, pool, nullptr);
+	}
+
+	uploader.destroy();
 
 	vkDestroyCommandPool(device, commandPool, nullptr);
 
+	#ifndef NDEBUG
+	allocator.printStatistics(std::cout);
+	#endif
+
+	allocator.destroy();
+
 	vkDestroyDevice(device, nullptr);
 	DestroyDebugReportCallbackEXT(instance, callback, nullptr);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
-	vkDestroyInstance(instance, nullptr);
 
-	glfwDestroyWindow(window);
+	if (!offscreen) {
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
+
+	vkDestroyInstance(instance, nullptr);
 
-	glfwTerminate();
+	if (!offscreen) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
 }
 
 void Engine::recreateSwapChain() {
-	vkDeviceWaitIdle(device);
+	// only the frames in flight can still be using the size dependent resources
+	vkWaitForFences(device, framesInFlight, inFlightFences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
 
 	cleanupSwapChain();
 
+	const VkFormat previousFormat = swapChainImageFormat;
+
 	createSwapChain();
 	createImageViews();
-	createRenderPass();
-	createGraphicsPipeline();
+
+	// the render pass and pipeline only depend on the image format, which a resize normally keeps
+	if (swapChainImageFormat != previousFormat) {
+		vkDestroyPipeline(device, graphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyRenderPass(device, renderPass, nullptr);
+
+		createRenderPass();
+		createGraphicsPipeline();
+	}
+
 	createDepthResources();
 	createFramebuffers();
 	createCommandBuffers();
@@ -275,13 +529,23 @@ void Engine::pickPhysicalDevice() {
 	if (physicalDevice == VK_NULL_HANDLE) {
 		throw std::runtime_error("failed to find a suitable GPU!");
 	}
+
+	// the packed layout relies on SSCALED positions, which are not a required vertex buffer format
+	for (const auto& attribute : Vertex::getAttributeDescriptions()) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, attribute.format, &props);
+
+		if (!(props.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT)) {
+			throw std::runtime_error("vertex attribute format " + std::to_string(attribute.format) + " is not supported by the GPU, rebuild without PACKED_VERTICES!");
+		}
+	}
 }
 
 void Engine::createLogicalDevice() {
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<int> uniqueQueueFamilies { indices.graphicsFamily, indices.presentFamily };
+	std::set<int> uniqueQueueFamilies { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
 
 	float queuePriority = 1.0f;
 	for (int queueFamily : uniqueQueueFamilies) {
@@ -303,7 +567,8 @@ void Engine::createLogicalDevice() {
 
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
-	createInfo.enabledExtensionCount = (uint32_t) deviceExtensions.size();
+	// offscreen rendering never presents, so it doesn't need the swap chain extension
+	createInfo.enabledExtensionCount = offscreen ? 0 : (uint32_t) deviceExtensions.size();
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 	if (enableValidationLayers) {
@@ -319,6 +584,7 @@ void Engine::createLogicalDevice() {
 
 	vkGetDeviceQueue(device, indices.graphicsFamily, 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
+	vkGetDeviceQueue(device, indices.transferFamily, 0, &transferQueue);
 }
 
 void Engine::createSwapChain() {
@@ -360,10 +626,20 @@ void Engine::createSwapChain() {
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
+	// handing over the old swap chain lets the presentation engine reuse its resources
+	VkSwapchainKHR oldSwapChain = swapChain;
+	createInfo.oldSwapchain = oldSwapChain;
+
 	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
 	}
 
+	// the in-flight fences only cover graphics submissions, a present queued on the old swap chain may still be pending
+	if (oldSwapChain != VK_NULL_HANDLE) {
+		vkQueueWaitIdle(presentQueue);
+		vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+	}
+
 	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
 	swapChainImages.resize(imageCount);
 	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
@@ -372,6 +648,19 @@ void Engine::createSwapChain() {
 	swapChainExtent = extent;
 }
 
+void Engine::createOffscreenTargets() {
+	swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	swapChainExtent = { WIDTH, HEIGHT };
+
+	// one target per frame in flight, so a frame never renders into an image the previous one is still using
+	swapChainImages.resize(framesInFlight);
+	offscreenImageAllocations.resize(framesInFlight);
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		createImage(WIDTH, HEIGHT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageAllocations[i]);
+	}
+}
+
 void Engine::createImageViews() {
 	swapChainImageViews.resize(swapChainImages.size());
 
@@ -413,7 +702,7 @@ void Engine::createRenderPass() {
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.finalLayout = offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentReference colorAttachmentRef {};
 	colorAttachmentRef.attachment = 0;
@@ -442,11 +731,22 @@ void Engine::createRenderPass() {
 	VkSubpassDependency dependency {};
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
+	// every frame in flight shares the depth image, so its clear must wait for the depth writes of the previous frame
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	// offscreen targets are read back with a copy after the pass, which has to see its color writes
+	VkSubpassDependency readbackDependency {};
+	readbackDependency.srcSubpass = 0;
+	readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+	readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	std::array<VkSubpassDependency, 2> dependencies { dependency, readbackDependency };
 	std::array<VkAttachmentDescription, 2> attachments { colorAttachment, depthAttachment };
 
 	VkRenderPassCreateInfo renderPassInfo {};
@@ -455,8 +755,8 @@ void Engine::createRenderPass() {
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	renderPassInfo.dependencyCount = offscreen ? 2 : 1;
+	renderPassInfo.pDependencies = dependencies.data();
 
 	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create render pass!");
@@ -465,20 +765,23 @@ void Engine::createRenderPass() {
 
 void Engine::createDescriptorSetLayout() {
 	VkDescriptorSetLayoutBinding uboLayoutBinding {};
-	uboLayoutBinding.binding = 0;
+	uboLayoutBinding.binding = 1;
 	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.pImmutableSamplers = nullptr;
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+	VkDescriptorSetLayoutBinding cameraLayoutBinding = uboLayoutBinding;
+	cameraLayoutBinding.binding = 0;
+
 	VkDescriptorSetLayoutBinding samplerLayoutBinding {};
-	samplerLayoutBinding.binding = 1;
+	samplerLayoutBinding.binding = 2;
 	samplerLayoutBinding.descriptorCount = 1;
 	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings { uboLayoutBinding, samplerLayoutBinding };
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings { cameraLayoutBinding, uboLayoutBinding, samplerLayoutBinding };
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -490,8 +793,89 @@ void Engine::createDescriptorSetLayout() {
 	}
 }
 
+void Engine::createPipelineCache() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	std::vector<char> data;
+	std::ifstream file(PIPELINE_CACHE_PATH, std::ios::binary | std::ios::ate);
+	const std::streamoff fileSize = file ? (std::streamoff) file.tellg() : 0;
+	file.seekg(0);
+
+	PipelineCacheFileHeader header {};
+
+	// a missing, truncated or foreign cache just means starting with an empty one
+	if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+		header.magic == PIPELINE_CACHE_MAGIC && header.vendorID == properties.vendorID &&
+		header.deviceID == properties.deviceID && header.driverVersion == properties.driverVersion &&
+		memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+		header.dataSize == (uint64_t) (fileSize - (std::streamoff) sizeof(header))) {
+
+		data.resize((size_t) header.dataSize);
+
+		if (!file.read(data.data(), data.size())) {
+			data.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+void Engine::savePipelineCache() {
+	size_t dataSize = 0;
+
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+		return;
+	}
+
+	std::vector<char> data(dataSize);
+
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	PipelineCacheFileHeader header {};
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+
+	// written under a temporary name and renamed so a crash never leaves a half written cache behind
+	const std::string tempPath = PIPELINE_CACHE_PATH + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(data.data(), dataSize);
+	file.close();
+
+	// the cache only speeds up the next start, failing to write it is not fatal
+	if (!file || rename(tempPath.c_str(), PIPELINE_CACHE_PATH.c_str()) != 0) {
+		std::cerr << "failed to write pipeline cache '" << PIPELINE_CACHE_PATH << "'" << std::endl;
+	}
+}
+
 void Engine::createGraphicsPipeline() {
-	auto vertShaderCode = readFile("shaders/vert.spv");
+	const char* vertShaderPath = "shaders/vert.spv";
+
+	if (renderMode == RenderMode::Instanced) {
+		vertShaderPath = "shaders/instanced.vert.spv";
+	} else if (renderMode == RenderMode::PushConstants) {
+		vertShaderPath = "shaders/push.vert.spv";
+	}
+
+	auto vertShaderCode = readFile(vertShaderPath);
 	auto fragShaderCode = readFile("shaders/frag.spv");
 
 	VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
@@ -514,12 +898,21 @@ void Engine::createGraphicsPipeline() {
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions { Vertex::getBindingDescription() };
+
+	auto vertexAttributeDescriptions = Vertex::getAttributeDescriptions();
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(vertexAttributeDescriptions.begin(), vertexAttributeDescriptions.end());
 
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	if (renderMode == RenderMode::Instanced) {
+		bindingDescriptions.push_back(UniformBufferObject::getInstanceBindingDescription((uint32_t) uniformStride));
+
+		auto instanceAttributeDescriptions = UniformBufferObject::getInstanceAttributeDescriptions();
+		attributeDescriptions.insert(attributeDescriptions.end(), instanceAttributeDescriptions.begin(), instanceAttributeDescriptions.end());
+	}
+
+	vertexInputInfo.vertexBindingDescriptionCount = (uint32_t) bindingDescriptions.size();
 	vertexInputInfo.vertexAttributeDescriptionCount = (uint32_t) attributeDescriptions.size();
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
@@ -527,24 +920,18 @@ void Engine::createGraphicsPipeline() {
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	VkViewport viewport {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float) swapChainExtent.width;
-	viewport.height = (float) swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapChainExtent;
-
+	// viewport and scissor are set while recording, so the pipeline survives a resize
 	VkPipelineViewportStateCreateInfo viewportState {};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+
+	std::array<VkDynamicState, 2> dynamicStates { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = (uint32_t) dynamicStates.size();
+	dynamicState.pDynamicStates = dynamicStates.data();
 
 	VkPipelineRasterizationStateCreateInfo rasterizer {};
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -581,6 +968,17 @@ void Engine::createGraphicsPipeline() {
 	pipelineLayoutInfo.setLayoutCount = 1;
 	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
 
+	// the translation of the entity being drawn
+	VkPushConstantRange pushConstantRange {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(glm::vec4);
+
+	if (renderMode == RenderMode::PushConstants) {
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	}
+
 	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create pipeline layout!");
 	}
@@ -604,12 +1002,13 @@ void Engine::createGraphicsPipeline() {
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = pipelineLayout;
 	pipelineInfo.renderPass = renderPass;
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
 
@@ -656,7 +1055,7 @@ void Engine::createCommandPool() {
 void Engine::createDepthResources() {
 	VkFormat depthFormat = findDepthFormat();
 
-	createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+	createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageAllocation);
 	depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
 	transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
@@ -671,32 +1070,18 @@ void Engine::createTextureImage() {
 		throw std::runtime_error("failed to load texture image!");
 	}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(device, stagingBufferMemory);
+	uploader.uploadImage(textureImage, pixels, imageSize, (uint32_t) texWidth, (uint32_t) texHeight);
 
 	stbi_image_free(pixels);
-
-	createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		copyBufferToImage(stagingBuffer, textureImage, (uint32_t) texWidth, (uint32_t) texHeight);
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
 }
 
 void Engine::createTextureImageViews() {
 	textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
 }
 
-void Engine::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void Engine::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageAllocation) {
 	VkImageCreateInfo imageInfo {};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -712,6 +1097,12 @@ void Engine::createImage(uint32_t width, uint32_t height, VkFormat format, VkIma
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+	if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && uploader.usesDedicatedQueue()) {
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = 2;
+		imageInfo.pQueueFamilyIndices = uploader.queueFamilies();
+	}
+
 	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create image!");
 	}
@@ -719,16 +1110,9 @@ void Engine::createImage(uint32_t width, uint32_t height, VkFormat format, VkIma
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+	imageAllocation = allocator.allocate(memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
 
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
-	}
-
-	vkBindImageMemory(device, image, imageMemory, 0);
+	vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset);
 }
 
 void Engine::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
@@ -793,29 +1177,6 @@ void Engine::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout
 	endSingleTimeCommands(commandBuffer);
 }
 
-void Engine::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-	VkBufferImageCopy region {};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = {
-		width,
-		height,
-		1
-	};
-
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	endSingleTimeCommands(commandBuffer);
-}
-
 void Engine::createTextureSampler() {
 	VkSamplerCreateInfo samplerInfo {};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -843,79 +1204,114 @@ void Engine::createTextureSampler() {
 void Engine::createVertexBuffer() {
 	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation);
+
+	uploader.uploadBuffer(vertexBuffer, vertices.data(), bufferSize);
+}
+
+void Engine::createIndexBuffer() {
+	// 16 bit indices halve the buffer whenever every vertex can be addressed with them
+	indexType = vertices.size() <= (size_t) std::numeric_limits<uint16_t>::max() + 1 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t) bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
+	VkDeviceSize bufferSize = (indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t)) * indices.size();
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation);
 
-	copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+	if (indexType == VK_INDEX_TYPE_UINT16) {
+		uint16_t* indices16 = reinterpret_cast<uint16_t*>(uploader.stage(indexBuffer, bufferSize));
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+		for (size_t i = 0; i < indices.size(); i++) {
+			indices16[i] = (uint16_t) indices[i];
+		}
+	} else {
+		uploader.uploadBuffer(indexBuffer, indices.data(), bufferSize);
+	}
 }
 
-void Engine::createIndexBuffer() {
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+void Engine::layoutUniformBuffer(VkDeviceSize alignment) {
+	uniformStride = (sizeof(UniformBufferObject) + alignment - 1) / alignment * alignment;
+	cameraStride = (sizeof(CameraBlock) + alignment - 1) / alignment * alignment;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	uniformSliceSize = uniformStride * entities.size();
+	cameraOffset = uniformSliceSize * framesInFlight;
+	uniformBufferSize = cameraOffset + cameraStride * framesInFlight;
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), (size_t) bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
+	staleModelMatrices.assign(framesInFlight, {});
+}
+
+void Engine::createUniformBuffer() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	layoutUniformBuffer(properties.limits.minUniformBufferOffsetAlignment);
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+	createBuffer(uniformBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer, uniformBufferAllocation);
 
-	copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+	uniformBufferMapped = uniformBufferAllocation.mapped;
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	resetModelMatrices();
 }
 
-void Engine::createUniformBuffer(Model& model) {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-	createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, model.uniformBuffer, model.uniformBufferMemory);
+void Engine::resetModelMatrices() {
+	const glm::mat4 identity(1.0f);
+
+	for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+		for (size_t i = 0; i < entities.size(); i++) {
+			memcpy(uniformBufferMapped + frame * uniformSliceSize + i * uniformStride + offsetof(UniformBufferObject, model), &identity, sizeof(identity));
+		}
+	}
+}
+
+void Engine::createDrawBatches() {
+	drawBatches.clear();
+
+	for (uint32_t i = 0; i < entities.size(); i++) {
+		const Model& model = models[entities.model[i]];
+
+		if (!drawBatches.empty() && drawBatches.back().firstIndex == model.firstIndex && drawBatches.back().indexCount == model.indexCount) {
+			drawBatches.back().instanceCount++;
+		} else {
+			drawBatches.push_back({ model.indexCount, model.firstIndex, i, 1 });
+		}
+	}
 }
 
 void Engine::createDescriptorPool() {
 	std::array<VkDescriptorPoolSize, 2> poolSizes {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = models.size();
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizes[0].descriptorCount = 2;
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = models.size();
+	poolSizes[1].descriptorCount = 1;
 
 	VkDescriptorPoolCreateInfo poolInfo {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = (uint32_t) poolSizes.size();
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = models.size();
+	poolInfo.maxSets = 1;
 
 	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create descriptor pool!");
 	}
 }
 
-void Engine::createDescriptorSet(Model& model) {
+void Engine::createDescriptorSet() {
 	VkDescriptorSetAllocateInfo allocInfo {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = descriptorPool;
 	allocInfo.descriptorSetCount = 1;
 	allocInfo.pSetLayouts = &descriptorSetLayout;
 
-	if (vkAllocateDescriptorSets(device, &allocInfo, &model.descriptorSet) != VK_SUCCESS) {
+	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate descriptor set!");
 	}
 
+	VkDescriptorBufferInfo cameraInfo {};
+	cameraInfo.buffer = uniformBuffer;
+	cameraInfo.offset = cameraOffset;
+	cameraInfo.range = sizeof(CameraBlock);
+
 	VkDescriptorBufferInfo bufferInfo {};
-	bufferInfo.buffer = model.uniformBuffer;
+	bufferInfo.buffer = uniformBuffer;
 	bufferInfo.offset = 0;
 	bufferInfo.range = sizeof(UniformBufferObject);
 
@@ -924,34 +1320,49 @@ void Engine::createDescriptorSet(Model& model) {
 	imageInfo.imageView = textureImageView;
 	imageInfo.sampler = textureSampler;
 
-	std::array<VkWriteDescriptorSet, 2> descriptorWrites {};
+	std::array<VkWriteDescriptorSet, 3> descriptorWrites {};
 
 	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[0].dstSet = model.descriptorSet;
+	descriptorWrites[0].dstSet = descriptorSet;
 	descriptorWrites[0].dstBinding = 0;
 	descriptorWrites[0].dstArrayElement = 0;
-	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	descriptorWrites[0].descriptorCount = 1;
-	descriptorWrites[0].pBufferInfo = &bufferInfo;
+	descriptorWrites[0].pBufferInfo = &cameraInfo;
 
 	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[1].dstSet = model.descriptorSet;
+	descriptorWrites[1].dstSet = descriptorSet;
 	descriptorWrites[1].dstBinding = 1;
 	descriptorWrites[1].dstArrayElement = 0;
-	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	descriptorWrites[1].descriptorCount = 1;
-	descriptorWrites[1].pImageInfo = &imageInfo;
+	descriptorWrites[1].pBufferInfo = &bufferInfo;
+
+	descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[2].dstSet = descriptorSet;
+	descriptorWrites[2].dstBinding = 2;
+	descriptorWrites[2].dstArrayElement = 0;
+	descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[2].descriptorCount = 1;
+	descriptorWrites[2].pImageInfo = &imageInfo;
 
 	vkUpdateDescriptorSets(device, (uint32_t) descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
 }
 
-void Engine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+void Engine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation) {
 	VkBufferCreateInfo bufferInfo {};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+	// written by the transfer queue and read by the graphics queue without ownership transfers
+	if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && uploader.usesDedicatedQueue()) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = uploader.queueFamilies();
+	}
+
 	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create buffer!");
 	}
@@ -959,16 +1370,9 @@ void Engine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryP
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate buffer memory!");
-	}
+	bufferAllocation = allocator.allocate(memRequirements, properties, true);
 
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+	vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
 }
 
 VkCommandBuffer Engine::beginSingleTimeCommands() {
@@ -1004,31 +1408,13 @@ void Engine::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-void Engine::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-	VkBufferCopy copyRegion {};
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	endSingleTimeCommands(commandBuffer);
-}
-
-uint32_t Engine::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
-		}
+void Engine::createCommandBuffers() {
+	if (recordsEveryFrame()) {
+		commandBuffers.clear();
+		return;
 	}
 
-	throw std::runtime_error("failed to find suitable memory type!");
-}
-
-void Engine::createCommandBuffers() {
-	commandBuffers.resize(swapChainFramebuffers.size());
+	commandBuffers.resize(framesInFlight * swapChainFramebuffers.size());
 
 	VkCommandBufferAllocateInfo allocInfo {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1041,80 +1427,264 @@ void Engine::createCommandBuffers() {
 	}
 
 	for (size_t i = 0; i < commandBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+		recordCommandBuffer(commandBuffers[i], (uint32_t) (i / swapChainFramebuffers.size()), (uint32_t) (i % swapChainFramebuffers.size()));
+	}
+}
+
+void Engine::createFrameCommandBuffers() {
+	if (!recordsEveryFrame()) {
+		return;
+	}
+
+	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+	frameCommandPools.resize(framesInFlight);
+	frameCommandBuffers.resize(framesInFlight);
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		VkCommandPoolCreateInfo poolInfo {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &frameCommandPools[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create frame command pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = frameCommandPools[i];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &frameCommandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate frame command buffer!");
+		}
+	}
+}
 
-		vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
+void Engine::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex) {
+	VkCommandBufferBeginInfo beginInfo {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = recordsEveryFrame() ? VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT : VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-		VkRenderPassBeginInfo renderPassInfo {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapChainExtent;
+	VkRenderPassBeginInfo renderPassInfo {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = swapChainExtent;
 
-		std::array<VkClearValue, 2> clearValues {};
-		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
+	std::array<VkClearValue, 2> clearValues {};
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
 
-		renderPassInfo.clearValueCount = (uint32_t) clearValues.size();
-		renderPassInfo.pClearValues = clearValues.data();
+	renderPassInfo.clearValueCount = (uint32_t) clearValues.size();
+	renderPassInfo.pClearValues = clearValues.data();
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, frame * 2, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, frame * 2);
+	}
 
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+		VkViewport viewport {};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = (float) swapChainExtent.width;
+		viewport.height = (float) swapChainExtent.height;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor {};
+		scissor.offset = { 0, 0 };
+		scissor.extent = swapChainExtent;
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		VkBuffer vertexBuffers[] { vertexBuffer };
+		VkDeviceSize offsets[] { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+
+		const uint32_t uniformSliceOffset = (uint32_t) (frame * uniformSliceSize);
+		const uint32_t cameraBlockOffset = (uint32_t) (frame * cameraStride);
+
+		if (renderMode == RenderMode::Instanced) {
+			VkBuffer instanceBuffers[] { uniformBuffer };
+			VkDeviceSize instanceOffsets[] { uniformSliceOffset };
+			vkCmdBindVertexBuffers(commandBuffer, 1, 1, instanceBuffers, instanceOffsets);
+
+			const uint32_t dynamicOffsets[] { cameraBlockOffset, uniformSliceOffset };
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 2, dynamicOffsets);
+
+			if (recordsEveryFrame()) {
+				// runs of live entities sharing a model, dead entities parked off screen are never drawn
+				for (uint32_t entity = 0; entity < entities.size(); ) {
+					if (!entities.alive[entity]) {
+						entity++;
+						continue;
+					}
+
+					uint32_t end = entity + 1;
+					while (end < entities.size() && entities.alive[end] && entities.model[end] == entities.model[entity]) {
+						end++;
+					}
+
+					const Model& model = models[entities.model[entity]];
+					vkCmdDrawIndexed(commandBuffer, model.indexCount, end - entity, model.firstIndex, 0, entity);
+
+					entity = end;
+				}
+			} else {
+				for (const DrawBatch& batch : drawBatches) {
+					vkCmdDrawIndexed(commandBuffer, batch.indexCount, batch.instanceCount, batch.firstIndex, 0, batch.firstInstance);
+				}
+			}
+		} else if (renderMode == RenderMode::PushConstants) {
+			const uint32_t dynamicOffsets[] { cameraBlockOffset, 0 };
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 2, dynamicOffsets);
 
-			VkBuffer vertexBuffers[] { vertexBuffer };
-			VkDeviceSize offsets[] { 0 };
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+			for (size_t entity = 0; entity < entities.size(); entity++) {
+				if (!entities.alive[entity]) {
+					continue;
+				}
 
-			vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				const Model& model = models[entities.model[entity]];
+				const glm::vec4 translation {glm::vec3{entities.x[entity], entities.y[entity], entities.z[entity]} - model.size / 2.0f, 0.0f};
 
-			for (const Model& model : models) {
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &model.descriptorSet, 0, nullptr);
-				vkCmdDrawIndexed(commandBuffers[i], model.indexCount, 1, model.firstIndex, 0, 0);
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(translation), &translation);
+				vkCmdDrawIndexed(commandBuffer, model.indexCount, 1, model.firstIndex, 0, 0);
 			}
+		} else {
+			for (size_t entity = 0; entity < entities.size(); entity++) {
+				if (recordsEveryFrame() && !entities.alive[entity]) {
+					continue;
+				}
 
-		vkCmdEndRenderPass(commandBuffers[i]);
+				const Model& model = models[entities.model[entity]];
 
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to record command buffer!");
+				const uint32_t dynamicOffsets[] { cameraBlockOffset, uniformSliceOffset + (uint32_t) (entity * uniformStride) };
+
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 2, dynamicOffsets);
+				vkCmdDrawIndexed(commandBuffer, model.indexCount, 1, model.firstIndex, 0, 0);
+			}
 		}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, frame * 2 + 1);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
 	}
 }
 
-void Engine::createSemaphores() {
+void Engine::createSyncObjects() {
+	imageAvailableSemaphores.resize(framesInFlight);
+	renderFinishedSemaphores.resize(framesInFlight);
+	inFlightFences.resize(framesInFlight);
+
 	VkSemaphoreCreateInfo semaphoreInfo {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS) {
+	VkFenceCreateInfo fenceInfo {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
+			vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
 
-		throw std::runtime_error("failed to create semaphores!");
+			throw std::runtime_error("failed to create synchronization objects for a frame!");
+		}
 	}
 }
 
-void Engine::updateUniformBuffers(const UniformBufferObject& ubo) {
-	constexpr size_t memSize = sizeof(UniformBufferObject) - offsetof(UniformBufferObject, view);
-	for (const Model& model : models) {
-		void* data;
-		vkMapMemory(device, model.uniformBufferMemory, offsetof(UniformBufferObject, view), memSize, 0, &data);
-			memcpy(data, &ubo.view, memSize);
-		vkUnmapMemory(device, model.uniformBufferMemory);
+void Engine::createTimestampQueryPool() {
+	if (profilePath.empty()) {
+		return;
 	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	if (queueFamilies[findQueueFamilies(physicalDevice).graphicsFamily].timestampValidBits == 0) {
+		std::cerr << "graphics queue does not support timestamps, GPU times will not be profiled" << std::endl;
+		return;
+	}
+
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	// a begin and end timestamp per frame in flight
+	VkQueryPoolCreateInfo poolInfo {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = framesInFlight * 2;
+
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+
+	pendingTimestamps.assign(framesInFlight, -1);
 }
 
-void Engine::updateModelMatrix(const Model& model) {
-	void* data;
-	vkMapMemory(device, model.uniformBufferMemory, 0, sizeof(model.modelMatrix), 0, &data);
-		memcpy(data, &model.modelMatrix, sizeof(model.modelMatrix));
-	vkUnmapMemory(device, model.uniformBufferMemory);
+void Engine::readTimestamps(uint32_t frame) {
+	if (timestampQueryPool == VK_NULL_HANDLE || pendingTimestamps[frame] < 0) {
+		return;
+	}
+
+	uint64_t timestamps[2];
+
+	if (vkGetQueryPoolResults(device, timestampQueryPool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+		profiler.records[pendingTimestamps[frame]].gpu = (timestamps[1] - timestamps[0]) * timestampPeriod / 1e6;
+	}
+
+	pendingTimestamps[frame] = -1;
+}
+
+void Engine::updateCameraBlocks(const CameraBlock& camera) {
+	for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+		memcpy(uniformBufferMapped + cameraOffset + frame * cameraStride, &camera, sizeof(camera));
+	}
+}
+
+VkCommandBuffer Engine::prepareCommandBuffer(uint32_t imageIndex) {
+	if (!recordsEveryFrame()) {
+		return commandBuffers[currentFrame * swapChainImages.size() + imageIndex];
+	}
+
+	// the fence of this frame was waited on in advanceFrame, so nothing allocated from its pool is in use
+	vkResetCommandPool(device, frameCommandPools[currentFrame], 0);
+	recordCommandBuffer(frameCommandBuffers[currentFrame], currentFrame, imageIndex);
+
+	return frameCommandBuffers[currentFrame];
 }
 
 void Engine::drawFrame() {
+	const auto acquireStart = FrameProfiler::Clock::now();
+
 	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	VkResult result = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+	if (!profilePath.empty()) {
+		profiler.records.back().acquire = FrameProfiler::millisecondsSince(acquireStart);
+	}
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		recreateSwapChain();
@@ -1126,23 +1696,31 @@ void Engine::drawFrame() {
 	VkSubmitInfo submitInfo {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] { imageAvailableSemaphore };
+	VkSemaphore waitSemaphores[] { imageAvailableSemaphores[currentFrame] };
 	VkPipelineStageFlags waitStages[] { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	submitInfo.waitSemaphoreCount = 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 
+	VkCommandBuffer commandBuffer = prepareCommandBuffer(imageIndex);
+
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &commandBuffer;
 
-	VkSemaphore signalSemaphores[] { renderFinishedSemaphore };
+	VkSemaphore signalSemaphores[] { renderFinishedSemaphores[currentFrame] };
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
 
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		pendingTimestamps[currentFrame] = (int64_t) profiler.records.size() - 1;
+	}
+
 	VkPresentInfoKHR presentInfo {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -1155,15 +1733,123 @@ void Engine::drawFrame() {
 
 	presentInfo.pImageIndices = &imageIndex;
 
+	const auto presentStart = FrameProfiler::Clock::now();
+
 	result = vkQueuePresentKHR(presentQueue, &presentInfo);
 
+	if (!profilePath.empty()) {
+		profiler.records.back().present = FrameProfiler::millisecondsSince(presentStart);
+	}
+
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
 		recreateSwapChain();
 	} else if (result != VK_SUCCESS) {
 		throw std::runtime_error("failed to present swap chain image!");
 	}
 
-	vkQueueWaitIdle(presentQueue);
+	advanceFrame();
+}
+
+void Engine::drawOffscreenFrame() {
+	VkCommandBuffer commandBuffer = prepareCommandBuffer(currentFrame);
+
+	VkSubmitInfo submitInfo {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit draw command buffer!");
+	}
+
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		pendingTimestamps[currentFrame] = (int64_t) profiler.records.size() - 1;
+	}
+
+	advanceFrame();
+}
+
+void Engine::captureImage(VkImage image, const std::string& path) {
+	const VkDeviceSize imageSize = swapChainExtent.width * swapChainExtent.height * 4;
+
+	VkBuffer readbackBuffer;
+	Allocation readbackBufferAllocation;
+	createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferAllocation);
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+	VkBufferImageCopy region {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	VkBufferMemoryBarrier barrier {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = readbackBuffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	endSingleTimeCommands(commandBuffer);
+
+	// binary PPM, the alpha channel is dropped
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file) {
+		throw std::runtime_error("failed to open file '" + path + "'!");
+	}
+
+	file << "P6\n" << swapChainExtent.width << " " << swapChainExtent.height << "\n255\n";
+
+	const char* pixels = readbackBufferAllocation.mapped;
+	std::vector<char> row(swapChainExtent.width * 3);
+
+	for (uint32_t y = 0; y < swapChainExtent.height; y++) {
+		for (uint32_t x = 0; x < swapChainExtent.width; x++) {
+			memcpy(&row[x * 3], pixels + (y * swapChainExtent.width + x) * 4, 3);
+		}
+
+		file.write(row.data(), row.size());
+	}
+
+	file.close();
+
+	vkDestroyBuffer(device, readbackBuffer, nullptr);
+	allocator.free(readbackBufferAllocation);
+
+	if (!file) {
+		throw std::runtime_error("failed to write file '" + path + "'!");
+	}
+}
+
+void Engine::advanceFrame() {
+	const uint32_t nextFrame = (currentFrame + 1) % framesInFlight;
+
+	vkWaitForFences(device, 1, &inFlightFences[nextFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	readTimestamps(nextFrame);
+
+	for (uint32_t entity : staleModelMatrices[nextFrame]) {
+		writeModelMatrix(nextFrame, entity);
+	}
+
+	staleModelMatrices[nextFrame].clear();
+
+	currentFrame = nextFrame;
 }
 
 VkFormat Engine::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
@@ -1281,6 +1967,10 @@ SwapChainSupportDetails Engine::querySwapChainSupport(VkPhysicalDevice device) {
 bool Engine::isDeviceSuitable(VkPhysicalDevice device) {
 	QueueFamilyIndices indices = findQueueFamilies(device);
 
+	if (offscreen) {
+		return indices.isComplete();
+	}
+
 	bool extensionsSupported = checkDeviceExtensionSupport(device);
 
 	bool swapChainAdequate = false;
@@ -1323,8 +2013,12 @@ QueueFamilyIndices Engine::findQueueFamilies(VkPhysicalDevice device) {
 			indices.graphicsFamily = i;
 		}
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		// without a surface nothing is presented, the graphics queue stands in for the present queue
+		VkBool32 presentSupport = offscreen && indices.graphicsFamily == i;
+
+		if (!offscreen) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		}
 
 		if (queueFamily.queueCount > 0 && presentSupport) {
 			indices.presentFamily = i;
@@ -1337,6 +2031,16 @@ QueueFamilyIndices Engine::findQueueFamilies(VkPhysicalDevice device) {
 		i++;
 	}
 
+	// a family without graphics support is usually a DMA engine that copies alongside rendering
+	indices.transferFamily = indices.graphicsFamily;
+
+	for (uint32_t j = 0; j < queueFamilyCount; j++) {
+		if (queueFamilies[j].queueCount > 0 && (queueFamilies[j].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamilies[j].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.transferFamily = (int) j;
+			break;
+		}
+	}
+
 	return indices;
 }
 
@@ -1344,8 +2048,11 @@ std::vector<const char*> Engine::getRequiredExtensions() {
 	std::vector<const char*> extensions;
 
 	unsigned int glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	const char** glfwExtensions = nullptr;
+
+	if (!offscreen) {
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	}
 
 	for (unsigned int i = 0; i < glfwExtensionCount; i++) {
 		extensions.push_back(glfwExtensions[i]);
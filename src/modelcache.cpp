@@ -0,0 +1,156 @@
+#include "modelcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static bool statSource(const std::string& sourcePath, uint64_t& size, int64_t& modified) {
+	struct stat st;
+
+	if (stat(sourcePath.c_str(), &st) != 0) {
+		return false;
+	}
+
+	size = (uint64_t) st.st_size;
+	modified = (int64_t) st.st_mtime;
+
+	return true;
+}
+
+bool ModelCache::open(const std::string& path, const std::string& sourcePath) {
+	close();
+
+	uint64_t sourceSize;
+	int64_t sourceModified;
+
+	if (!statSource(sourcePath, sourceSize, sourceModified)) {
+		return false;
+	}
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ModelCacheHeader)) {
+		::close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	mapping = data;
+	mappingSize = (size_t) st.st_size;
+
+	const ModelCacheHeader* header = static_cast<const ModelCacheHeader*>(mapping);
+
+	const size_t expectedSize = sizeof(ModelCacheHeader)
+		+ (size_t) header->modelCount * sizeof(ModelCacheEntry)
+		+ (size_t) header->vertexCount * sizeof(Vertex)
+		+ (size_t) header->indexCount * sizeof(uint32_t);
+
+	if (header->magic != MODEL_CACHE_MAGIC || header->version != MODEL_CACHE_VERSION ||
+		header->vertexSize != sizeof(Vertex) || header->modelSize != sizeof(ModelCacheEntry) ||
+		header->sourceSize != sourceSize || header->sourceModified != sourceModified ||
+		expectedSize != mappingSize) {
+
+		close();
+		return false;
+	}
+
+	const char* cursor = static_cast<const char*>(mapping) + sizeof(ModelCacheHeader);
+
+	modelCount = header->modelCount;
+	entries = reinterpret_cast<const ModelCacheEntry*>(cursor);
+	cursor += modelCount * sizeof(ModelCacheEntry);
+
+	vertexCount = header->vertexCount;
+	vertices = reinterpret_cast<const Vertex*>(cursor);
+	cursor += vertexCount * sizeof(Vertex);
+
+	indexCount = header->indexCount;
+	indices = reinterpret_cast<const uint32_t*>(cursor);
+
+	// a cache of the right size can still be corrupt or hand edited, anything that would be read out of bounds on
+	// the host or the GPU makes it stale like any other mismatch
+	for (uint32_t i = 0; i < modelCount; i++) {
+		const ModelCacheEntry& entry = entries[i];
+
+		if (memchr(entry.name, '\0', sizeof(entry.name)) == nullptr ||
+			entry.model.firstIndex > indexCount || entry.model.indexCount > indexCount - entry.model.firstIndex) {
+
+			close();
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < indexCount; i++) {
+		if (indices[i] >= vertexCount) {
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ModelCache::close() {
+	if (mapping != nullptr) {
+		munmap(mapping, mappingSize);
+	}
+
+	mapping = nullptr;
+	mappingSize = 0;
+
+	entries = nullptr;
+	vertices = nullptr;
+	indices = nullptr;
+	modelCount = vertexCount = indexCount = 0;
+}
+
+void ModelCache::write(const std::string& path, const std::string& sourcePath, const std::vector<ModelCacheEntry>& entries, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	ModelCacheHeader header {};
+	header.magic = MODEL_CACHE_MAGIC;
+	header.version = MODEL_CACHE_VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.modelSize = sizeof(ModelCacheEntry);
+	header.modelCount = (uint32_t) entries.size();
+	header.vertexCount = (uint32_t) vertices.size();
+	header.indexCount = (uint32_t) indices.size();
+
+	if (!statSource(sourcePath, header.sourceSize, header.sourceModified)) {
+		throw std::runtime_error("failed to stat file '" + sourcePath + "'!");
+	}
+
+	// written under a temporary name and renamed so a running instance never maps a half written cache
+	const std::string tempPath = path + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!file) {
+		throw std::runtime_error("failed to open file '" + tempPath + "'!");
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ModelCacheEntry));
+	file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex));
+	file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+	file.close();
+
+	if (!file || rename(tempPath.c_str(), path.c_str()) != 0) {
+		throw std::runtime_error("failed to write file '" + path + "'!");
+	}
+}
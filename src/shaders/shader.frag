@@ -6,7 +6,7 @@ layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 1) uniform sampler2D texSampler;
+layout(binding = 2) uniform sampler2D texSampler;
 
 void main() {
 	outColor = texture(texSampler, fragTexCoord) * vec4(fragColor, 1.0f);
@@ -1,10 +1,13 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 0) uniform UniformBufferObject {
-	mat4 model;
+layout(binding = 0) uniform CameraBlock {
 	mat4 view;
 	mat4 proj;
+} camera;
+
+layout(binding = 1) uniform UniformBufferObject {
+	mat4 model;
 } ubo;
 
 layout(location = 0) in vec3 inPosition;
@@ -19,7 +22,7 @@ out gl_PerVertex {
 };
 
 void main() {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+	gl_Position = camera.proj * camera.view * ubo.model * vec4(inPosition, 1.0);
 	fragColor = inColor;
 	fragTexCoord = inTexCoord;
 }
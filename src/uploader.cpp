@@ -0,0 +1,289 @@
+#include "uploader.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+// satisfies the offset alignment of buffer copies and of image copies for every texel size up to 16 bytes
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+void Uploader::init(VkDevice device, DeviceAllocator& allocator, uint32_t graphicsFamily, uint32_t transferFamily, VkQueue transferQueue) {
+	this->device = device;
+	this->allocator = &allocator;
+	families[0] = graphicsFamily;
+	families[1] = transferFamily;
+	queue = transferQueue;
+
+	VkCommandPoolCreateInfo poolInfo {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = transferFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	VkBufferCreateInfo bufferInfo {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = RING_SIZE;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &ring) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create staging ring!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, ring, &memRequirements);
+
+	ringAllocation = allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+	vkBindBufferMemory(device, ring, ringAllocation.memory, ringAllocation.offset);
+}
+
+void Uploader::destroy() {
+	wait();
+
+	for (Batch& batch : batches) {
+		releaseOversized(batch);
+		vkDestroyFence(device, batch.fence, nullptr);
+	}
+
+	batches.clear();
+	freeBatches.clear();
+
+	vkDestroyBuffer(device, ring, nullptr);
+	allocator->free(ringAllocation);
+
+	vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+char* Uploader::stage(VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset) {
+	const Staging staging = allocateStaging(size);
+
+	VkBufferCopy copyRegion {};
+	copyRegion.srcOffset = staging.offset;
+	copyRegion.dstOffset = offset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(begin(), staging.buffer, buffer, 1, &copyRegion);
+
+	return staging.mapped;
+}
+
+void Uploader::uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset) {
+	memcpy(stage(buffer, size, offset), data, (size_t) size);
+}
+
+void Uploader::uploadImage(VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height) {
+	const Staging staging = allocateStaging(size);
+	memcpy(staging.mapped, data, (size_t) size);
+
+	VkCommandBuffer commandBuffer = begin();
+
+	VkImageMemoryBarrier barrier {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region {};
+	region.bufferOffset = staging.offset;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+
+	vkCmdCopyBufferToImage(commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	// transfer queues can't name the fragment shader stage, the fence wait makes the copy visible before any draw
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void Uploader::submit() {
+	if (recordingBatch == SIZE_MAX) {
+		return;
+	}
+
+	Batch& batch = batches[recordingBatch];
+
+	if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record upload command buffer!");
+	}
+
+	VkSubmitInfo submitInfo {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	if (vkQueueSubmit(queue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit uploads!");
+	}
+
+	pendingBatches.push_back(recordingBatch);
+	recordingBatch = SIZE_MAX;
+}
+
+void Uploader::wait() {
+	submit();
+
+	while (!pendingBatches.empty()) {
+		reclaimOldest();
+	}
+}
+
+void Uploader::poll() {
+	while (!pendingBatches.empty() && vkGetFenceStatus(device, batches[pendingBatches.front()].fence) == VK_SUCCESS) {
+		reclaimOldest();
+	}
+}
+
+Uploader::Staging Uploader::allocateStaging(VkDeviceSize size) {
+	if (size <= RING_SIZE) {
+		const VkDeviceSize offset = allocateRing(size);
+		return { ring, offset, ringAllocation.mapped + offset };
+	}
+
+	VkBufferCreateInfo bufferInfo {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkBuffer buffer;
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create staging buffer!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	Allocation allocation = allocator->allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+	vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+
+	begin();
+	batches[recordingBatch].oversizedBuffers.push_back(buffer);
+	batches[recordingBatch].oversizedAllocations.push_back(allocation);
+
+	return { buffer, 0, allocation.mapped };
+}
+
+VkDeviceSize Uploader::allocateRing(VkDeviceSize size) {
+	poll();
+
+	for (;;) {
+		VkDeviceSize offset = (ringHead + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+		VkDeviceSize padding = offset - ringHead;
+
+		// an allocation never straddles the end, the rest of the ring is skipped instead
+		if (offset + size > RING_SIZE) {
+			offset = 0;
+			padding = RING_SIZE - ringHead;
+		}
+
+		if (ringUsed + padding + size <= RING_SIZE) {
+			ringHead = offset + size;
+			ringUsed += padding + size;
+
+			begin();
+			batches[recordingBatch].ringBytes += padding + size;
+
+			return offset;
+		}
+
+		// the space still held by the batch being recorded can only be released by submitting it
+		if (pendingBatches.empty()) {
+			submit();
+		}
+
+		reclaimOldest();
+	}
+}
+
+void Uploader::reclaimOldest() {
+	Batch& batch = batches[pendingBatches.front()];
+
+	vkWaitForFences(device, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	vkResetFences(device, 1, &batch.fence);
+
+	ringUsed -= batch.ringBytes;
+	releaseOversized(batch);
+
+	// an empty ring starts over at the beginning, so the next batch doesn't have to wrap
+	if (ringUsed == 0) {
+		ringHead = 0;
+	}
+
+	freeBatches.push_back(pendingBatches.front());
+	pendingBatches.pop_front();
+}
+
+void Uploader::releaseOversized(Batch& batch) {
+	for (size_t i = 0; i < batch.oversizedBuffers.size(); i++) {
+		vkDestroyBuffer(device, batch.oversizedBuffers[i], nullptr);
+		allocator->free(batch.oversizedAllocations[i]);
+	}
+
+	batch.oversizedBuffers.clear();
+	batch.oversizedAllocations.clear();
+}
+
+VkCommandBuffer Uploader::begin() {
+	if (recordingBatch != SIZE_MAX) {
+		return batches[recordingBatch].commandBuffer;
+	}
+
+	if (freeBatches.empty()) {
+		Batch batch;
+
+		VkCommandBufferAllocateInfo allocInfo {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		batches.push_back(batch);
+		freeBatches.push_back(batches.size() - 1);
+	}
+
+	recordingBatch = freeBatches.back();
+	freeBatches.pop_back();
+
+	Batch& batch = batches[recordingBatch];
+	batch.ringBytes = 0;
+
+	VkCommandBufferBeginInfo beginInfo {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+	return batch.commandBuffer;
+}